@@ -16,11 +16,16 @@ With its modular design, developers can easily extend its functionality to suit
 #include "http_request.hpp"
 #include "http_response.hpp"
 #include "http_constants.hpp"
+#include "http_compression.hpp"
+#include "http_static_files.hpp"
+#include "http_router.hpp"
 
 #include <functional>
 #include <string>
 #include <stdexcept>
 #include <ctime>
+#include <vector>
+#include <memory>
 
 /// @brief Namespace for the HTTP server library. All the classes, functions, and constants related to the HTTP server are defined within this namespace.
 namespace http
@@ -42,8 +47,33 @@ namespace http
     /// Configuration structure for the HTTP server. It contains various parameters that can be set to configure the behavior of the server, such as the port to listen on, maximum pending connections, maximum concurrent connections, timeout for inactive connections, and whether to enable external logging.
     ///  - port The port number on which the HTTP server will listen for incoming connections. It is an unsigned short integer. Default is 8080 for this library.
     ///  - max_pending_connections The maximum number of pending connections that the server can have in its queue. This parameter controls how many incoming connections can be waiting to be accepted before the server starts rejecting new connections. It is an unsigned integer. Default is 128 for this library.
-    ///  - max_concurrent_connections The maximum number of concurrent connections that the server can handle at any given time. It is an unsigned integer. If the number of active connections exceeds this limit, the server may start rejecting new connections until some of the existing connections are closed. Default is 128 for this library.
-    ///  - max_request_body_size The maximum request body size in bytes. Requests exceeding this size are rejected with 413 Payload Too Large. Default is 1 MiB for this library.
+    ///  - max_concurrent_connections The maximum number of concurrent connections that the server can handle at any given time. It is an unsigned integer. Once this limit is reached the server stops accepting new connections, leaving them queued in the kernel backlog, and resumes accepting as existing connections are closed. Default is 128 for this library.
+    ///  - reserved_connections Additional connection slots beyond max_concurrent_connections that can only be used by peers listed in reserved_connection_sources, so that health checks keep working while the server is saturated. While only reserved slots are left, connections from other peers are accepted and closed immediately. Default is 0 for this library.
+    ///  - reserved_connection_sources IP addresses (e.g. load balancer health checkers) that may use the reserved connection slots. Default is empty for this library.
+    ///  - max_accepts_per_iteration The maximum number of connections accepted in a single event loop iteration. Peers left over stay in the backlog until the next iteration, so a reconnect storm cannot starve established connections. Default is 64 for this library.
+    ///  - io_quantum_bytes The maximum number of bytes read from or written to one connection per wakeup. A connection with more work left is served again after the other ready connections, so one bulk transfer cannot delay small responses sharing the same thread. Default is 64 KiB for this library.
+    ///  - io_buffer_size The initial size of a connection's I/O buffer in bytes. Default is 8 KiB for this library.
+    ///  - io_buffer_max_size The size up to which a connection's I/O buffer grows, doubling each time, while a request body arrives faster than one buffer per read or the socket accepts a whole buffer per send. The send side is further capped by the socket's send buffer (SO_SNDBUF). The buffer goes back to the pool once the connection is idle. Default is 256 KiB for this library.
+    ///  - max_request_line_size The maximum request line size in bytes. Longer request lines are rejected with 414 URI Too Long. Default is 8 KiB for this library.
+    ///  - max_header_size The maximum size of the header block in bytes. Larger header blocks are rejected with 431 Request Header Fields Too Large. Default is 8 KiB for this library.
+    ///  - io_buffer_pool_blocks The number of io_buffer_size I/O buffers preallocated in the server-wide buffer pool. Connections borrow a buffer only while a request or response is in flight. If more are needed they are allocated from the heap. 0 sizes the pool to one buffer per connection slot. Default is 0 for this library.
+    ///  - io_buffer_huge_pages A boolean flag requesting that the buffer pool arena be backed by huge pages (Linux MAP_HUGETLB, Windows large pages). Falls back to regular pages when none are available. Without it the arena is mapped twice back to back where the platform allows it, so each buffer works as a ring and received bytes are never moved; huge page buffers give that up. Default is false for this library.
+    ///  - body_producer_threads The number of threads that run response body generators set with HttpResponse::set_body_generator. Generators then run off the threads that write to sockets, so a slow generator cannot stall other responses. 0 runs generators on the sending thread. Default is 2 for this library.
+    ///  - body_producer_high_watermark The number of generated bytes that may be buffered ahead of the socket for one response. The generator is paused once this much is buffered. Default is 256 KiB for this library.
+    ///  - body_producer_low_watermark The number of buffered bytes at or below which a paused generator is resumed. Default is 64 KiB for this library.
+    ///  - compression A boolean flag enabling compression of response bodies for clients whose Accept-Encoding allows it. Compressed bodies are sent chunked with Content-Encoding set, and Vary: Accept-Encoding is added to every response that could have been compressed. Default is false for this library.
+    ///  - compression_codecs The content codings offered, most preferred first; request_decompression decodes the same codings. Clients' q-values decide, ties go to the earlier codec. Empty uses the built-in gzip and deflate codecs, which need the library to be built with zlib. Default is empty for this library.
+    ///  - compression_level The codec specific compression level; for zlib 1 is fastest and 9 smallest. Default is 6 for this library.
+    ///  - compression_min_size Bodies with a Content-Length below this many bytes are sent uncompressed. Bodies of unknown length are always compressed. Default is 1 KiB for this library.
+    ///  - compression_excluded_types Content types that are already compressed and sent as they are. An entry ending in '/' matches all subtypes. Responses with a Content-Encoding header are never compressed again. Default is common image, audio, video, archive and font types for this library.
+    ///  - request_decompression A boolean flag that makes request bodies sent with a Content-Encoding of one of compression_codecs read decompressed from HttpRequest::body(). Decoding runs in get_next() on the handler thread, a buffer at a time. Headers are left as the client sent them. Undecodable bodies fail the read and are answered with 400 Bad Request. Default is false for this library.
+    ///  - response_cache A boolean flag enabling the server-side response cache. GET responses with a Cache-Control max-age (or s-maxage) are stored for that long and answered from the event loop without calling the handler. If-None-Match matching the stored ETag is answered with 304 Not Modified. Cached responses are sent uncompressed. Default is false for this library.
+    ///  - response_cache_size The byte budget of the response cache; the least recently used responses are evicted beyond it. Default is 64 MiB for this library.
+    ///  - response_cache_vary_headers The request headers that are part of the cache key and of the request_coalescing key. Responses with a Vary header naming any other header are not cached. Default is Accept, Accept-Encoding and Accept-Language for this library.
+    ///  - request_coalescing A boolean flag collapsing identical requests in flight, keyed like the response cache. The first request runs the handler; identical ones arriving meanwhile are parked without a thread and sent the same response bytes. Responses that can not be shared (Set-Cookie, private or no-store, a body generator, Vary on other headers) make the parked requests run the handler themselves. Default is false for this library.
+    ///  - range_requests A boolean flag answering GET requests with a Range header with 206 Partial Content when the 200 response has a body of known size: set with set_body, set_snapshot, from the response cache or a StaticFiles file. Several ranges are sent as multipart/byteranges, only the requested bytes are read and files are sent with sendfile. An If-Range that does not match the strong ETag or the Last-Modified date gets the whole body; ranges outside the body get 416 Range Not Satisfiable. Ranged responses are never compressed. Default is true for this library.
+    ///  - max_request_body_size The maximum request body size in bytes. Requests exceeding this size are rejected with 413 Payload Too Large. With request_decompression the limit applies to the compressed and to the decompressed body. Default is 1 MiB for this library.
+    ///  - server_header The value of the Server header added to every response, unless the handler sets its own. Empty sends no Server header. A Date header is always added the same way. Default is empty for this library.
     ///  - inactive_connection_timeout_in_seconds The timeout duration in seconds for inactive connections. If a connection remains idle (i.e., no data is sent or received) for longer than this duration, the server may close the connection to free up resources. It is a time_t value. Default is 60 seconds for this library.
     ///  - enable_logging A boolean flag indicating whether to enable logging. If set to true, the server will log information about incoming requests, responses, and other events. If set to false, the server will not log any information. The default value is false. Default is false for this library.
     ///  - external_logging A boolean flag indicating whether to enable external logging. If set to true, the server will log information about incoming requests, responses, and other events to an external logging system. If set to false, the server will log to stdout and stderr. Default is false for this library.
@@ -55,8 +85,62 @@ namespace http
         unsigned int max_pending_connections = 128;
         /// Maximum concurrent active connections.
         unsigned int max_concurrent_connections = 128;
+        /// Extra connection slots reserved for reserved_connection_sources.
+        unsigned int reserved_connections = 0;
+        /// Peer IP addresses allowed to use the reserved connection slots.
+        std::vector<std::string> reserved_connection_sources;
+        /// Maximum connections accepted per event loop iteration.
+        unsigned int max_accepts_per_iteration = 64;
+        /// Maximum bytes read from or written to one connection per wakeup.
+        size_t io_quantum_bytes = 64 * 1024;
+        /// Initial I/O buffer size of a connection.
+        size_t io_buffer_size = 8 * 1024;
+        /// Largest I/O buffer a busy connection grows to.
+        size_t io_buffer_max_size = 256 * 1024;
+        /// Maximum accepted request line size in bytes.
+        size_t max_request_line_size = 8 * 1024;
+        /// Maximum accepted header block size in bytes.
+        size_t max_header_size = 8 * 1024;
+        /// Preallocated I/O buffers, 0 means one per connection slot.
+        size_t io_buffer_pool_blocks = 0;
+        /// Backs the I/O buffer pool with huge pages when available.
+        bool io_buffer_huge_pages = false;
+        /// Threads running response body generators, 0 runs them on the sending thread.
+        unsigned int body_producer_threads = 2;
+        /// Generated bytes buffered per response before its generator is paused.
+        size_t body_producer_high_watermark = 256 * 1024;
+        /// Buffered bytes at or below which a paused generator is resumed.
+        size_t body_producer_low_watermark = 64 * 1024;
+        /// Compresses response bodies for clients that accept it.
+        bool compression = false;
+        /// Offered content codings, most preferred first; empty uses the built-in zlib codecs.
+        std::vector<std::shared_ptr<CompressionCodec>> compression_codecs;
+        /// Codec specific compression level.
+        int compression_level = 6;
+        /// Smallest Content-Length that is compressed.
+        size_t compression_min_size = 1024;
+        /// Content types sent uncompressed, entries ending in '/' match all subtypes.
+        std::vector<std::string> compression_excluded_types = {
+            "image/png", "image/jpeg", "image/gif", "image/webp", "image/avif",
+            "audio/", "video/",
+            "application/gzip", "application/x-gzip", "application/zip", "application/zstd", "application/x-bzip2", "application/x-xz", "application/x-7z-compressed",
+            "font/woff", "font/woff2"};
+        /// Decodes compressed request bodies with compression_codecs.
+        bool request_decompression = false;
+        /// Caches GET responses with a Cache-Control max-age.
+        bool response_cache = false;
+        /// Byte budget of the response cache.
+        size_t response_cache_size = 64 * 1024 * 1024;
+        /// Request headers that are part of the cache key.
+        std::vector<std::string> response_cache_vary_headers = {"accept", "accept-encoding", "accept-language"};
+        /// Runs the handler once for identical requests in flight.
+        bool request_coalescing = false;
+        /// Answers Range requests for bodies of known size with 206 Partial Content.
+        bool range_requests = true;
         /// Maximum accepted request body size in bytes.
         size_t max_request_body_size = 1024 * 1024;
+        /// Server header value, empty sends none.
+        std::string server_header;
         /// Idle timeout for a connection, in seconds.
         time_t inactive_connection_timeout_in_seconds = 60;
         /// Enables built-in logging.
@@ -65,6 +149,35 @@ namespace http
         bool external_logging = false;
     };
 
+    /// Occupancy of the server-wide I/O buffer pool.
+    struct BufferPoolStats
+    {
+        /// Size of one buffer in bytes.
+        size_t block_size = 0;
+        /// Buffers preallocated in the pool arena.
+        size_t arena_blocks = 0;
+        /// Bytes mapped for the arena.
+        size_t arena_bytes = 0;
+        /// True if the arena is backed by huge pages.
+        bool huge_pages = false;
+        /// True if arena buffers are mapped twice back to back and used as ring buffers.
+        bool mirrored = false;
+        /// Buffers currently borrowed by connections.
+        size_t blocks_in_use = 0;
+        /// Highest number of buffers borrowed at the same time.
+        size_t peak_blocks_in_use = 0;
+        /// Borrowed buffers that did not fit in the arena and came from the heap.
+        size_t heap_blocks_in_use = 0;
+        /// Total heap allocations made because the arena was exhausted.
+        size_t heap_allocations = 0;
+        /// Size of the largest buffer a connection can grow to.
+        size_t max_block_size = 0;
+        /// Borrowed buffers larger than block_size.
+        size_t large_blocks_in_use = 0;
+        /// Total allocations of buffers larger than block_size, reused ones not counted.
+        size_t large_allocations = 0;
+    };
+
     /// @brief A simple HTTP server.
     class HttpServer
     {
@@ -90,6 +203,18 @@ namespace http
 
         /// @brief Starts the server to listen for incoming requests.
         void start();
+
+        /// @brief Snapshot of the I/O buffer pool occupancy. Safe to call from any thread.
+        BufferPoolStats buffer_pool_stats() const;
+
+        /// @brief Keeps the file cache of files current from file system notifications (inotify) read by the event loop,
+        /// instead of checking cached files again after StaticFilesConfig::revalidate_after_seconds.
+        /// Cache hits then need no system call; changed, created, removed or renamed files and directories are dropped from the cache.
+        /// Changes to files reached through symbolic links are not reported. Not supported on Windows, where the files keep being revalidated by age.
+        /// Call before start(); copies of files share the watch.
+        /// @throws std::logic_error If files are already watched or the server was started.
+        /// @throws std::runtime_error If the notifications can not be polled; files are then revalidated by age as before.
+        void watch_static_files(const StaticFiles &files);
     };
 }
 #endif // HTTP_HPP
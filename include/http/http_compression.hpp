@@ -0,0 +1,106 @@
+/// @file http_compression.hpp
+/// @brief This file defines the interface of the content codings used to compress response bodies and decode request bodies.
+
+#ifndef HTTP_COMPRESSION_HPP
+#define HTTP_COMPRESSION_HPP
+
+#include <string>
+#include <memory>
+#include <cstddef>
+
+namespace http
+{
+    /// @brief Streaming compressor for one response body at a time.
+    /// Instances are pooled per thread and reused for later responses after reset().
+    class Compressor
+    {
+    public:
+        /// @brief How much of the compressed stream compress() has to emit.
+        enum Flush
+        {
+            /// The compressor may keep input back to compress it better.
+            NO_FLUSH,
+            /// Everything consumed so far is emitted, used while the body source has nothing new.
+            SYNC_FLUSH,
+            /// The input is the end of the body, the stream is completed.
+            FINISH
+        };
+
+        /// @brief Outcome of one compress() call.
+        struct Result
+        {
+            /// Input bytes consumed.
+            size_t consumed = 0;
+            /// Output bytes written.
+            size_t produced = 0;
+            /// True once the end of the stream was written; only after FINISH.
+            bool finished = false;
+        };
+
+        virtual ~Compressor() = default;
+
+        /// @brief Prepares the compressor for a new body, keeping its allocated state.
+        virtual void reset() = 0;
+
+        /// @brief Compresses input into output.
+        /// @param input Body bytes.
+        /// @param input_size Number of body bytes at input.
+        /// @param output Buffer for compressed bytes.
+        /// @param output_size Capacity of output.
+        /// @param flush See Flush. With FINISH the call is repeated until Result::finished is set.
+        /// @return Bytes consumed and produced.
+        /// @throws std::runtime_error If the compressor fails.
+        virtual Result compress(const char *input, size_t input_size, char *output, size_t output_size, Flush flush) = 0;
+    };
+
+    /// @brief Streaming decompressor for one request body.
+    class Decompressor
+    {
+    public:
+        /// @brief Outcome of one decompress() call.
+        struct Result
+        {
+            /// Input bytes consumed.
+            size_t consumed = 0;
+            /// Output bytes written.
+            size_t produced = 0;
+            /// True once the end of the compressed stream was consumed.
+            bool finished = false;
+        };
+
+        virtual ~Decompressor() = default;
+
+        /// @brief Decompresses input into output.
+        /// Output the decompressor holds back because output was full is produced by later calls, also with no new input.
+        /// @param input Compressed bytes.
+        /// @param input_size Number of compressed bytes at input.
+        /// @param output Buffer for decompressed bytes.
+        /// @param output_size Capacity of output.
+        /// @return Bytes consumed and produced.
+        /// @throws std::runtime_error If the input is not valid for the coding.
+        virtual Result decompress(const char *input, size_t input_size, char *output, size_t output_size) = 0;
+    };
+
+    /// @brief A content coding (e.g. gzip) that responses can be compressed with and request bodies decoded from.
+    class CompressionCodec
+    {
+    public:
+        virtual ~CompressionCodec() = default;
+
+        /// @return Content coding token used in Accept-Encoding and Content-Encoding, lowercase (e.g. "gzip").
+        virtual std::string name() const = 0;
+
+        /// @brief Creates a new compressor.
+        /// @param level Codec specific compression level.
+        virtual std::unique_ptr<Compressor> create_compressor(int level) const = 0;
+
+        /// @brief Creates a new decompressor for request bodies.
+        /// @return The decompressor, or nullptr if the codec only compresses.
+        virtual std::unique_ptr<Decompressor> create_decompressor() const
+        {
+            return nullptr;
+        }
+    };
+}
+
+#endif // HTTP_COMPRESSION_HPP
@@ -23,6 +23,24 @@ namespace http
         const std::string WARNING = "warning";
         const std::string IF_MATCH = "if-match";
         const std::string IF_NONE_MATCH = "if-none-match";
+        const std::string DATE = "date";
+        const std::string SERVER = "server";
+        const std::string CONTENT_TYPE = "content-type";
+        const std::string CONTENT_ENCODING = "content-encoding";
+        const std::string VARY = "vary";
+        const std::string ETAG = "etag";
+        const std::string AUTHORIZATION = "authorization";
+        const std::string SET_COOKIE = "set-cookie";
+        const std::string EXPIRES = "expires";
+        const std::string CONTENT_LOCATION = "content-location";
+        const std::string PRAGMA = "pragma";
+        const std::string LOCATION = "location";
+        const std::string ALLOW = "allow";
+        const std::string RANGE = "range";
+        const std::string IF_RANGE = "if-range";
+        const std::string ACCEPT_RANGES = "accept-ranges";
+        const std::string CONTENT_RANGE = "content-range";
+        const std::string LAST_MODIFIED = "last-modified";
     }
 
     namespace methods
@@ -48,16 +66,21 @@ namespace http
         const int OK = 200;
         const int CREATED = 201;
         const int NO_CONTENT = 204;
+        const int PARTIAL_CONTENT = 206;
+        const int MOVED_PERMANENTLY = 301;
+        const int NOT_MODIFIED = 304;
         const int BAD_REQUEST = 400;
         const int UNAUTHORIZED = 401;
         const int FORBIDDEN = 403;
         const int NOT_FOUND = 404;
+        const int METHOD_NOT_ALLOWED = 405;
         const int INTERNAL_SERVER_ERROR = 500;
         const int NOT_IMPLEMENTED = 501;
         const int BAD_GATEWAY = 502;
         const int SERVICE_UNAVAILABLE = 503;
         const int URI_TOO_LONG = 414;
         const int PAYLOAD_TOO_LARGE = 413;
+        const int RANGE_NOT_SATISFIABLE = 416;
         const int HEADERS_TOO_LARGE = 431;
         const int HTTP_VERSION_NOT_SUPPORTED = 505;
     }
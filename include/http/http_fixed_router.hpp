@@ -0,0 +1,325 @@
+/// @file http_fixed_router.hpp
+/// @brief This file defines FixedRouter, a request handler whose route table is a perfect hash built at compile time.
+/// Not included by http.hpp: the table is built by C++14 constexpr functions, while the rest of the library needs C++11 only.
+
+#ifndef HTTP_FIXED_ROUTER_HPP
+#define HTTP_FIXED_ROUTER_HPP
+
+#if __cplusplus < 201402L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#error "http_fixed_router.hpp needs C++14 or later"
+#endif
+
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_constants.hpp"
+
+#include <functional>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace http
+{
+    /// @brief A route of a FixedRouter, for constexpr route arrays.
+    struct FixedRoute
+    {
+        /// Request method, e.g. "GET".
+        const char *method;
+        /// Exact request path, percent-encoded as it arrives; the query is not part of it.
+        const char *path;
+        void (*handler)(const HttpRequest &request, HttpResponse &response);
+    };
+
+    /// Compile time helpers of FixedRouter.
+    namespace fixed_routes
+    {
+        constexpr size_t length(const char *text)
+        {
+            size_t size = 0;
+            while (text[size] != '\0')
+            {
+                ++size;
+            }
+            return size;
+        }
+
+        constexpr bool equal(const char *a, const char *b)
+        {
+            size_t i = 0;
+            while (a[i] != '\0' && a[i] == b[i])
+            {
+                ++i;
+            }
+            return a[i] == b[i];
+        }
+
+        /// @brief 64-bit FNV-1a of the path part of a request target, the same at compile time and at run time.
+        /// @param size Length of target.
+        /// @param path_size Set to the length of the path, which ends at the first '?' or '#'.
+        constexpr uint64_t hash_path(const char *target, size_t size, size_t &path_size)
+        {
+            uint64_t value = 14695981039346656037ULL;
+            size_t i = 0;
+            for (; i < size && target[i] != '?' && target[i] != '#'; ++i)
+            {
+                value = (value ^ static_cast<unsigned char>(target[i])) * 1099511628211ULL;
+            }
+            path_size = i;
+            return value;
+        }
+
+        /// @return The displacement bucket of a hash, from other bits than the slot.
+        constexpr size_t bucket(uint64_t hash, size_t bucket_count)
+        {
+            return static_cast<size_t>((hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ULL >> 40) % bucket_count;
+        }
+
+        /// @return The slot of a hash in a table of mask + 1 slots for a bucket's displacement.
+        constexpr size_t slot(uint64_t hash, uint32_t displacement, size_t mask)
+        {
+            return static_cast<size_t>(static_cast<uint32_t>(hash) + displacement * static_cast<uint32_t>((hash >> 32) | 1)) & mask;
+        }
+
+        /// @return Slots for count paths: a power of two at least twice count.
+        constexpr size_t table_size(size_t count)
+        {
+            size_t size = 2;
+            while (size < 2 * count)
+            {
+                size *= 2;
+            }
+            return size;
+        }
+
+        /// @brief Perfect hash of the distinct paths of a route array, with the routes sharing a path chained by method.
+        template <size_t Count, size_t Size = table_size(Count), size_t Buckets = (Size + 3) / 4>
+        struct Table
+        {
+            static const size_t SIZE = Size;
+            static const size_t BUCKETS = Buckets;
+
+            /// Added to the slot step of the paths of each bucket until they all land in free slots.
+            uint32_t displacements[Buckets];
+            /// Index of the first route of the path hashed to each slot, -1 for a free slot.
+            int slots[Size];
+            /// Index of the next route with the same path, -1 at the end.
+            int next[Count];
+            /// False if a method and path pair is registered twice.
+            bool unique;
+            /// False if the paths could not be placed, which a different route order or count fixes.
+            bool placed;
+        };
+
+        /// @brief Tries the displacements of one bucket until its paths land in free slots, then takes them.
+        /// @param keys Routes of the bucket's paths at keys[first .. first + key_count).
+        template <size_t Count, size_t Size, size_t Buckets>
+        constexpr bool place(Table<Count, Size, Buckets> &table, const uint64_t (&hashes)[Count], const size_t (&keys)[Count], size_t first, size_t key_count, size_t bucket)
+        {
+            for (uint32_t displacement = 0; displacement < 64 * Size; ++displacement)
+            {
+                bool fits = true;
+                for (size_t i = first; i < first + key_count && fits; ++i)
+                {
+                    size_t slot_i = slot(hashes[keys[i]], displacement, Size - 1);
+                    fits = table.slots[slot_i] < 0;
+                    for (size_t j = first; j < i && fits; ++j)
+                    {
+                        fits = slot(hashes[keys[j]], displacement, Size - 1) != slot_i;
+                    }
+                }
+                if (fits)
+                {
+                    table.displacements[bucket] = displacement;
+                    for (size_t i = first; i < first + key_count; ++i)
+                    {
+                        table.slots[slot(hashes[keys[i]], displacement, Size - 1)] = static_cast<int>(keys[i]);
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// @brief Builds the table of routes[0 .. Count), biggest buckets first.
+        /// Work stays about linear in Count: the compiler bounds constexpr evaluation, comparing every pair of paths would not fit.
+        template <size_t Count>
+        constexpr Table<Count> build(const FixedRoute *routes)
+        {
+            typedef Table<Count> Built;
+            Built table{};
+            table.unique = true;
+            table.placed = true;
+            for (size_t i = 0; i < Built::SIZE; ++i)
+            {
+                table.slots[i] = -1;
+            }
+
+            // Routes sorted by bucket (counting sort), in route order within a bucket.
+            uint64_t hashes[Count] = {};
+            size_t buckets[Count] = {};
+            size_t starts[Built::BUCKETS + 1] = {};
+            for (size_t i = 0; i < Count; ++i)
+            {
+                size_t path_size = 0;
+                hashes[i] = hash_path(routes[i].path, length(routes[i].path), path_size);
+                buckets[i] = bucket(hashes[i], Built::BUCKETS);
+                table.next[i] = -1;
+                ++starts[buckets[i] + 1];
+            }
+            for (size_t b = 0; b < Built::BUCKETS; ++b)
+            {
+                starts[b + 1] += starts[b];
+            }
+            size_t keys[Count] = {};
+            size_t filled[Built::BUCKETS] = {};
+            for (size_t i = 0; i < Count; ++i)
+            {
+                keys[starts[buckets[i]] + filled[buckets[i]]++] = i;
+            }
+
+            // Routes repeating a path are chained to its first route and dropped from the bucket, which keeps one key per path.
+            size_t bucket_sizes[Built::BUCKETS] = {};
+            size_t largest = 0;
+            for (size_t b = 0; b < Built::BUCKETS; ++b)
+            {
+                size_t &size = bucket_sizes[b];
+                for (size_t k = starts[b]; k < starts[b + 1]; ++k)
+                {
+                    size_t i = keys[k];
+                    bool repeated = false;
+                    for (size_t d = starts[b]; d < starts[b] + size && !repeated; ++d)
+                    {
+                        size_t last = keys[d];
+                        if (hashes[last] != hashes[i] || !equal(routes[i].path, routes[last].path))
+                        {
+                            continue;
+                        }
+                        repeated = true;
+                        while (true)
+                        {
+                            table.unique = table.unique && !equal(routes[i].method, routes[last].method);
+                            if (table.next[last] < 0)
+                            {
+                                break;
+                            }
+                            last = static_cast<size_t>(table.next[last]);
+                        }
+                        table.next[last] = static_cast<int>(i);
+                    }
+                    if (!repeated)
+                    {
+                        keys[starts[b] + size++] = i;
+                    }
+                }
+                largest = size > largest ? size : largest;
+            }
+
+            for (size_t size = largest; size > 0; --size)
+            {
+                for (size_t b = 0; b < Built::BUCKETS; ++b)
+                {
+                    if (bucket_sizes[b] == size)
+                    {
+                        table.placed = table.placed && place(table, hashes, keys, starts[b], size, b);
+                    }
+                }
+            }
+            return table;
+        }
+    }
+
+    /// @brief Request handler for a route set fixed at compile time, dispatching on exact path and method.
+    /// The routes are a constexpr array at namespace scope; its perfect hash table is built by the compiler, so the router
+    /// needs no startup work and a match costs one hash of the path, one comparison of it and one of the method per route of the path.
+    /// Paths with captures belong in a Router, which can be the fallback:
+    /// @code
+    /// constexpr http::FixedRoute ROUTES[] = {{"GET", "/health", &health}, {"GET", "/users", &list_users}, {"POST", "/users", &add_user}};
+    /// http::FixedRouter<ROUTES, sizeof(ROUTES) / sizeof(ROUTES[0])> router(dynamic_router);
+    /// @endcode
+    /// A repeated route or a table that found no perfect hash fails to compile. Tables of thousands of routes may need the
+    /// compiler's constexpr evaluation limit raised (-fconstexpr-ops-limit for GCC, -fconstexpr-steps for Clang).
+    /// @tparam Routes The route array; a method and path pair may appear once.
+    /// @tparam Count Number of routes in Routes.
+    template <const FixedRoute *Routes, size_t Count>
+    class FixedRouter
+    {
+    private:
+        typedef fixed_routes::Table<Count> Table;
+        static constexpr Table TABLE = fixed_routes::build<Count>(Routes);
+
+        static_assert(Count > 0, "HTTP: A FixedRouter needs at least one route");
+        static_assert(TABLE.unique, "HTTP: A FixedRouter route is registered twice");
+        static_assert(TABLE.placed, "HTTP: The FixedRouter paths found no perfect hash");
+
+        std::function<void(const HttpRequest &, HttpResponse &)> fallback;
+
+        /// @return Index of the first route of the request's path, -1 if no route has it.
+        static int find(const HttpRequest &request) noexcept
+        {
+            const std::string &uri = request.uri();
+            size_t size = 0;
+            uint64_t hash = fixed_routes::hash_path(uri.data(), uri.size(), size);
+            int index = TABLE.slots[fixed_routes::slot(hash, TABLE.displacements[fixed_routes::bucket(hash, Table::BUCKETS)], Table::SIZE - 1)];
+            if (index < 0 || std::strlen(Routes[index].path) != size || std::memcmp(Routes[index].path, uri.data(), size) != 0)
+            {
+                return -1;
+            }
+            return index;
+        }
+
+    public:
+        /// @param fallback Called for requests no route matches; empty answers them with 404 Not Found.
+        explicit FixedRouter(std::function<void(const HttpRequest &, HttpResponse &)> fallback = nullptr) : fallback(std::move(fallback)) {}
+
+        /// @brief Calls the handler of the route matching the request's path and method.
+        /// @return False, leaving response untouched, if there is none.
+        bool route(const HttpRequest &request, HttpResponse &response) const
+        {
+            for (int index = find(request); index >= 0; index = TABLE.next[index])
+            {
+                if (request.method() == Routes[index].method)
+                {
+                    Routes[index].handler(request, response);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// @brief Like route(), passing requests it does not route to the fallback.
+        /// Without a fallback they get 404 Not Found, or 405 Method Not Allowed with an Allow header if only other methods have the path.
+        void operator()(const HttpRequest &request, HttpResponse &response) const
+        {
+            if (route(request, response))
+            {
+                return;
+            }
+            if (fallback)
+            {
+                fallback(request, response);
+                return;
+            }
+            int index = find(request);
+            if (index >= 0)
+            {
+                std::string allow;
+                for (; index >= 0; index = TABLE.next[index])
+                {
+                    allow += allow.empty() ? Routes[index].method : std::string(", ") + Routes[index].method;
+                }
+                response.set_status_text(http::status_codes::METHOD_NOT_ALLOWED, "Method Not Allowed");
+                response.set_header(http::headers::ALLOW, allow);
+            }
+            else
+            {
+                response.set_status_text(http::status_codes::NOT_FOUND, "Not Found");
+            }
+        }
+    };
+
+    template <const FixedRoute *Routes, size_t Count>
+    constexpr typename FixedRouter<Routes, Count>::Table FixedRouter<Routes, Count>::TABLE;
+}
+
+#endif // HTTP_FIXED_ROUTER_HPP
@@ -11,9 +11,38 @@
 #include <vector>
 #include <functional>
 #include <cstdint>
+#include <cstddef>
+#include <memory>
 
 namespace http
 {
+    /// @brief Immutable, preserialized HTTP response: status line, headers and body as wire bytes.
+    /// Created with HttpResponse::freeze() and sent with HttpResponse::set_snapshot().
+    /// Copies share the same reference-counted bytes, so a snapshot can be kept around and sent from any thread.
+    class HttpResponseSnapshot
+    {
+    private:
+        struct Impl;
+        std::shared_ptr<const Impl> pimpl;
+
+        explicit HttpResponseSnapshot(std::shared_ptr<const Impl> impl);
+
+    public:
+        /// @brief Creates an empty snapshot that holds no response.
+        HttpResponseSnapshot();
+
+        /// @return True if the snapshot holds a response.
+        explicit operator bool() const noexcept;
+        /// @return HTTP status code of the frozen response.
+        int status_code() const noexcept;
+        /// @return Size of the serialized response in bytes. The Date and Server headers added when sending are not included.
+        size_t size() const noexcept;
+
+        friend class HttpResponse;
+        friend struct HttpResponseReader;
+        friend struct HttpResponseBuilder;
+    };
+
     /// @brief Container for HTTP response data.
     class HttpResponse
     {
@@ -89,6 +118,26 @@ namespace http
         /// @param value Header value as a std::string.
         void set_header(const std::string &key, const std::string &value);
 
+        /// @brief Sets the status with its reason phrase as a plain text body, as the library's handlers answer requests they do not serve.
+        /// Content-Type and Content-Length are set for the body; other headers, such as Allow, are left to the caller.
+        /// @param status_code The HTTP status code (e.g., 404).
+        /// @param reason_phrase The HTTP status message, also the body (e.g., "Not Found").
+        void set_status_text(int status_code, const std::string &reason_phrase);
+
+        /// @brief Serializes the status line, headers and body into an immutable snapshot.
+        /// Content-Length and "Connection: close" are set as they would be when sending; a Date header is added
+        /// on every send unless one was set here. The response itself is not modified.
+        /// @return The snapshot, to be sent by later responses with set_snapshot().
+        /// @throws std::logic_error If the body was set with set_body_generator, or a Transfer-Encoding header is set.
+        HttpResponseSnapshot freeze() const;
+
+        /// @brief Sends the snapshot as this response. Its wire bytes are written as they are, together with the
+        /// server's Date and Server headers, in a single send where the socket allows it.
+        /// Status code and reason phrase are taken from the snapshot, headers and body set on this response are ignored.
+        /// @param snapshot A non-empty snapshot returned by freeze().
+        /// @throws std::invalid_argument If the snapshot is empty.
+        void set_snapshot(const HttpResponseSnapshot &snapshot);
+
         friend struct HttpResponseReader;
         friend struct HttpResponseBuilder;
     };
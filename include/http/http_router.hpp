@@ -0,0 +1,149 @@
+/// @file http_router.hpp
+/// @brief This file defines Router, a request handler dispatching requests to handlers registered by method and path pattern.
+
+#ifndef HTTP_ROUTER_HPP
+#define HTTP_ROUTER_HPP
+
+#include "http_request.hpp"
+#include "http_response.hpp"
+
+#include <functional>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstring>
+
+namespace http
+{
+    /// @brief Read-only view of a part of a request's URI, valid as long as the request.
+    struct PathView
+    {
+        const char *data = nullptr;
+        size_t size = 0;
+
+        /// @return True if the view is set, an empty wildcard tail is set but empty.
+        explicit operator bool() const noexcept
+        {
+            return data != nullptr;
+        }
+
+        bool empty() const noexcept
+        {
+            return size == 0;
+        }
+
+        /// @return A copy of the viewed bytes.
+        std::string str() const
+        {
+            return std::string(data ? data : "", size);
+        }
+
+        bool operator==(const char *other) const noexcept
+        {
+            return std::strlen(other) == size && (size == 0 || std::memcmp(data, other, size) == 0);
+        }
+
+        bool operator!=(const char *other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    /// @brief Values the ':name' and '*name' segments of a matched route captured, in pattern order.
+    /// Values are views into the request's URI and are not percent-decoded. Matching fills them without allocating.
+    class RouteParams
+    {
+    public:
+        /// Most captures a pattern may have.
+        static const size_t MAX_PARAMS = 16;
+
+    private:
+        struct Param
+        {
+            const std::string *name;
+            PathView value;
+        };
+
+        Param params[MAX_PARAMS];
+        size_t count = 0;
+
+    public:
+        /// @return Number of captured values.
+        size_t size() const noexcept
+        {
+            return count;
+        }
+
+        /// @return The value captured by the index-th capture of the pattern.
+        PathView operator[](size_t index) const noexcept
+        {
+            return index < count ? params[index].value : PathView();
+        }
+
+        /// @return The name of the index-th capture, without the ':' or '*'.
+        const std::string &name(size_t index) const noexcept
+        {
+            return *params[index].name;
+        }
+
+        /// @return The value captured under name, an unset view if the pattern has no such capture.
+        PathView get(const char *name) const noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (*params[i].name == name)
+                {
+                    return params[i].value;
+                }
+            }
+            return PathView();
+        }
+
+        friend class Router;
+    };
+
+    /// @brief Handler of a route, called with the values the route's pattern captured.
+    using RouteHandler = std::function<void(const http::HttpRequest &, http::HttpResponse &, const http::RouteParams &)>;
+
+    /// @brief Request handler dispatching on method and path through a radix tree of the registered patterns.
+    /// Matching walks the request path once, comparing whole shared prefixes, and does not allocate.
+    ///
+    /// Patterns start with '/' and consist of
+    ///  - static text, matched byte for byte against the percent-encoded path;
+    ///  - ':name', capturing the non-empty rest of a path segment (up to the next '/');
+    ///  - '*name' at the end, capturing the rest of the path including slashes, possibly empty.
+    /// Static text takes precedence over a capture, a capture over a wildcard; a branch that does not lead to a route for the
+    /// request's method falls back to the next one. With GET /users/me and POST /users/:id registered, POST /users/me reaches the capture.
+    /// The query and fragment of the request URI are not part of the matched path.
+    ///
+    /// Routes are added before the router is handed to the server; matching is const and can run on all handler threads at once.
+    /// Copies share the same routes.
+    class Router
+    {
+    private:
+        struct Impl;
+        std::shared_ptr<Impl> pimpl;
+
+    public:
+        Router();
+
+        /// @brief Registers a route.
+        /// @param method Request method the route answers, e.g. http::methods::GET; "*" answers every method without a route of its own.
+        /// @param pattern Path pattern, see Router.
+        /// @param handler Called for matching requests.
+        /// @return This router, for chained calls.
+        /// @throws std::invalid_argument If the pattern is malformed, has more than RouteParams::MAX_PARAMS captures,
+        /// names a capture differently than a registered pattern at the same place, or the method and pattern are already registered.
+        Router &add(const std::string &method, const std::string &pattern, RouteHandler handler);
+
+        /// @brief Calls the handler of the route matching the request.
+        /// @return False, leaving response untouched, if no route matches the path and method.
+        bool route(const HttpRequest &request, HttpResponse &response) const;
+
+        /// @brief Like route(), answering requests it does not route with 404 Not Found,
+        /// or 405 Method Not Allowed with an Allow header listing the methods of every pattern matching the path if there is one.
+        void operator()(const HttpRequest &request, HttpResponse &response) const;
+    };
+}
+
+#endif // HTTP_ROUTER_HPP
@@ -0,0 +1,82 @@
+/// @file http_static_files.hpp
+/// @brief This file defines StaticFiles, a request handler serving the files below a directory.
+
+#ifndef HTTP_STATIC_FILES_HPP
+#define HTTP_STATIC_FILES_HPP
+
+#include "http_request.hpp"
+#include "http_response.hpp"
+#include "http_compression.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <ctime>
+
+namespace http
+{
+    /// @brief Configuration of a StaticFiles handler.
+    struct StaticFilesConfig
+    {
+        /// File served for request paths ending in '/'.
+        std::string index_file = "index.html";
+        /// Files, directories and missing paths whose status is cached; regular files keep their descriptor open while cached.
+        size_t max_open_files = 256;
+        /// Files up to this size are read into memory and sent from there, larger ones are sent with sendfile.
+        size_t memory_cache_max_file_size = 64 * 1024;
+        /// Byte budget of the files held in memory.
+        size_t memory_cache_size = 16 * 1024 * 1024;
+        /// Seconds a cached file status is trusted before the file is checked for changes again, 0 checks on every request.
+        /// Not used for files below directories watched with HttpServer::watch_static_files.
+        time_t revalidate_after_seconds = 1;
+        /// Cache-Control header of every file response, empty sends none.
+        std::string cache_control;
+        /// Content types by lowercase file extension without the dot (e.g. {"md", "text/markdown"}), added to and overriding the built-in table.
+        std::unordered_map<std::string, std::string> mime_types;
+        /// Sibling files holding a compressed copy of a file, as {content coding, file name suffix}, most preferred first.
+        /// A client whose Accept-Encoding allows the coding is sent the sibling (e.g. app.js.gz for app.js) with Content-Encoding.
+        /// Siblings older than the file are ignored. An empty list disables the lookup.
+        std::vector<std::pair<std::string, std::string>> precompressed_files = {{"br", ".br"}, {"gzip", ".gz"}};
+        /// Compresses files held in memory once when they are loaded, with each of compression_codecs that has no sibling file.
+        /// Already compressed content types are skipped, a copy is only kept if it is smaller than the file.
+        bool memory_cache_compression = true;
+        /// Codecs for memory_cache_compression, most preferred after the sibling files. Empty uses the built-in gzip and deflate codecs, none without zlib.
+        std::vector<std::shared_ptr<CompressionCodec>> compression_codecs;
+        /// Codec specific level of memory_cache_compression; a file is compressed once, so the default favours size.
+        int compression_level = 9;
+    };
+
+    /// @brief Request handler serving the files below a root directory.
+    /// Request paths are percent-decoded; paths with a segment starting with '.' (including ".." and hidden files),
+    /// a backslash or a NUL byte are never served. Symbolic links below the root are followed.
+    /// Responses carry Content-Type, a strong ETag and Cache-Control; If-None-Match is answered with 304 Not Modified.
+    /// Files with compressed copies (see StaticFilesConfig::precompressed_files) are sent in the coding the client prefers, with Vary: Accept-Encoding.
+    /// A directory requested without a trailing slash is redirected to the path with one.
+    /// Copies share the same file cache, a StaticFiles can be passed as the server's RequestHandler directly or called from one.
+    class StaticFiles
+    {
+    private:
+        struct Impl;
+        std::shared_ptr<Impl> pimpl;
+
+    public:
+        /// @param root Directory the request paths are resolved against.
+        /// @param config Cache sizes and response headers.
+        /// @throws std::invalid_argument If root is not a directory.
+        explicit StaticFiles(const std::string &root, StaticFilesConfig config = StaticFilesConfig());
+
+        /// @brief Answers a GET request for a file below the root.
+        /// @return False, leaving response untouched, if the request is not a GET or names no file below the root.
+        bool serve(const HttpRequest &request, HttpResponse &response) const;
+
+        /// @brief Like serve(), answering requests it does not serve with 404 Not Found, or 405 Method Not Allowed if they are not GET.
+        void operator()(const HttpRequest &request, HttpResponse &response) const;
+
+        friend struct StaticFilesWatch;
+    };
+}
+
+#endif // HTTP_STATIC_FILES_HPP
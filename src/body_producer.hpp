@@ -0,0 +1,230 @@
+#ifndef BODY_PRODUCER_HPP
+#define BODY_PRODUCER_HPP
+
+#include "http/http_response.hpp"
+#include "data_stream.hpp"
+
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace http
+{
+    /// Runs a response body generator away from the thread that writes the socket.
+    ///
+    /// Generated bytes pass through a bounded single-producer/single-consumer ring:
+    /// - producer: produce(), called by one body producer thread at a time
+    /// - consumer: read() and park_consumer(), called by whichever thread currently sends the response
+    ///
+    /// The producer pauses once the ring is full (high watermark) and is handed back to
+    /// the scheduler when the consumer drains it down to the low watermark. A consumer that
+    /// finds the ring empty parks and is woken once the producer publishes more bytes.
+    class BodyProducer
+    {
+    public:
+        using Wakeup = std::function<void()>;
+
+    private:
+        HttpResponse::WriterFunction writer;
+        // Scratch buffer handed to writer, bytes [chunk_cursor, chunk_size) are not in the ring yet.
+        std::vector<char> chunk;
+        size_t chunk_cursor = 0;
+        size_t chunk_size = 0;
+
+        std::vector<char> ring;
+        size_t low_watermark;
+        // Total bytes read by the consumer / written by the producer, ring offsets are taken modulo ring size.
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+
+        std::atomic<bool> closed{false};
+        std::atomic<bool> failed{false};
+        std::atomic<bool> cancelled{false};
+        std::atomic<bool> consumer_parked{false};
+        std::atomic<bool> producer_parked{false};
+        std::string error_message;
+
+        Wakeup consumer_wakeup;
+        Wakeup producer_wakeup;
+
+        void wake_consumer()
+        {
+            if (consumer_parked.load() && consumer_parked.exchange(false))
+            {
+                consumer_wakeup();
+            }
+        }
+
+        /// Moves pending scratch bytes into the ring as far as it has room.
+        void publish_chunk()
+        {
+            size_t used = tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire);
+            size_t bytes = std::min(chunk_size - chunk_cursor, ring.size() - used);
+            if (bytes == 0)
+            {
+                return;
+            }
+
+            size_t offset = tail.load(std::memory_order_relaxed) % ring.size();
+            size_t first = std::min(bytes, ring.size() - offset);
+            std::memcpy(ring.data() + offset, chunk.data() + chunk_cursor, first);
+            std::memcpy(ring.data(), chunk.data() + chunk_cursor + first, bytes - first);
+            chunk_cursor += bytes;
+            tail.fetch_add(bytes, std::memory_order_release);
+            wake_consumer();
+        }
+
+    public:
+        /// @param writer Body generator, only ever called from produce().
+        /// @param high_watermark Ring capacity; the generator is paused while it is full.
+        /// @param low_watermark Buffered bytes at or below which a paused generator is resumed.
+        /// @param chunk_bytes Size of the buffer passed to writer.
+        BodyProducer(HttpResponse::WriterFunction writer, size_t high_watermark, size_t low_watermark, size_t chunk_bytes)
+            : writer(std::move(writer)),
+              chunk(std::max<size_t>(chunk_bytes, 1)),
+              ring(std::max<size_t>(high_watermark, 1)),
+              low_watermark(std::min(low_watermark, ring.size() - 1)) {}
+
+        BodyProducer(const BodyProducer &) = delete;
+        BodyProducer &operator=(const BodyProducer &) = delete;
+
+        /// @param on_data_available Called from the producer thread after a parked consumer got bytes (or end of stream).
+        /// @param on_space_available Called from the consumer thread when a paused producer has to be scheduled again.
+        void set_wakeups(Wakeup on_data_available, Wakeup on_space_available)
+        {
+            consumer_wakeup = std::move(on_data_available);
+            producer_wakeup = std::move(on_space_available);
+        }
+
+        /// Runs the generator until the ring is full, the body ends, the consumer went away, or quantum bytes were generated.
+        /// @return True if the generator used up the quantum or had nothing ready, and has to be scheduled again.
+        bool produce(size_t quantum)
+        {
+            size_t bytes_produced = 0;
+            while (!cancelled.load())
+            {
+                if (bytes_produced >= quantum)
+                {
+                    return true;
+                }
+
+                if (chunk_cursor < chunk_size)
+                {
+                    publish_chunk();
+                    if (chunk_cursor < chunk_size)
+                    {
+                        producer_parked.store(true);
+                        size_t used = tail.load() - head.load();
+                        // Re-check after parking so a drain that happened meanwhile is not missed.
+                        if (used > low_watermark || !producer_parked.exchange(false))
+                        {
+                            return false;
+                        }
+                    }
+                    continue;
+                }
+
+                int64_t bytes_written = -1;
+                try
+                {
+                    bytes_written = writer(chunk);
+                }
+                catch (const std::exception &e)
+                {
+                    error_message = e.what();
+                    failed.store(true);
+                }
+                catch (...)
+                {
+                    error_message = "Unknown error in body generator.";
+                    failed.store(true);
+                }
+
+                if (bytes_written == -1)
+                {
+                    closed.store(true);
+                    wake_consumer();
+                    return false;
+                }
+
+                if (bytes_written == 0)
+                {
+                    // Nothing ready yet, poll again after the other queued generators had their turn.
+                    return true;
+                }
+
+                chunk_cursor = 0;
+                chunk_size = std::min(static_cast<size_t>(bytes_written), chunk.size());
+                bytes_produced += chunk_size;
+            }
+            return false;
+        }
+
+        /// Copies buffered body bytes into buffer.
+        /// @return Bytes copied, 0 when the ring is empty for now, -1 when the body is complete.
+        /// @throws DataStream::StreamPipelineBroken if the generator failed.
+        int64_t read(char *buffer, size_t buffer_size, size_t buffer_pointer, size_t max_size)
+        {
+            // closed is published after the last tail update, so it has to be loaded first.
+            bool is_closed = closed.load();
+            size_t current_head = head.load(std::memory_order_relaxed);
+            size_t available = tail.load(std::memory_order_acquire) - current_head;
+            if (available == 0)
+            {
+                if (!is_closed)
+                {
+                    return 0;
+                }
+                if (failed.load())
+                {
+                    throw DataStream::StreamPipelineBroken("BodyProducer: " + error_message);
+                }
+                return -1;
+            }
+
+            if (buffer_pointer >= buffer_size)
+            {
+                return 0;
+            }
+
+            size_t bytes = std::min({available, max_size, buffer_size - buffer_pointer});
+            size_t offset = current_head % ring.size();
+            size_t first = std::min(bytes, ring.size() - offset);
+            std::memcpy(buffer + buffer_pointer, ring.data() + offset, first);
+            std::memcpy(buffer + buffer_pointer + first, ring.data(), bytes - first);
+            head.store(current_head + bytes, std::memory_order_release);
+
+            if (producer_parked.load() && available - bytes <= low_watermark && producer_parked.exchange(false))
+            {
+                producer_wakeup();
+            }
+            return static_cast<int64_t>(bytes);
+        }
+
+        /// Parks the consumer until the producer publishes more bytes.
+        /// @return False if bytes arrived meanwhile and the caller should keep sending itself.
+        bool park_consumer()
+        {
+            consumer_parked.store(true);
+            if (tail.load() != head.load() || closed.load())
+            {
+                // Whoever clears the flag resumes the response; if the producer already did, it calls the wakeup.
+                return !consumer_parked.exchange(false);
+            }
+            return true;
+        }
+
+        /// Stops the generator at its next iteration; called when the response is destroyed.
+        void cancel()
+        {
+            consumer_parked.store(false);
+            cancelled.store(true);
+        }
+    };
+}
+
+#endif // BODY_PRODUCER_HPP
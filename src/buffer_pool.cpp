@@ -0,0 +1,220 @@
+#include "buffer_pool.hpp"
+
+#include <algorithm>
+
+http::BufferPool::BufferPool(size_t block_size, size_t block_count, size_t max_block_size, bool huge_pages) : block_size(std::max<size_t>(block_size, 1)), block_stride(this->block_size), large_huge_pages(huge_pages)
+{
+    while ((this->block_size << large_classes) < max_block_size)
+    {
+        ++large_classes;
+    }
+    free_large_blocks.resize(large_classes);
+
+    if (block_count > 0 && !huge_pages)
+    {
+        arena = map_mirrored_arena(this->block_size, block_count);
+        if (arena)
+        {
+            arena_mirrored = true;
+            block_stride = 2 * this->block_size;
+            arena_blocks = block_count;
+            arena_bytes = this->block_size * block_count;
+        }
+    }
+
+    size_t bytes = this->block_size * block_count;
+    if (!arena && bytes > 0)
+    {
+        arena_huge_pages = huge_pages;
+        arena = map_arena(bytes, arena_huge_pages);
+        if (arena)
+        {
+            arena_bytes = bytes;
+            // Rounding up to whole pages may leave room for a few extra blocks.
+            arena_blocks = arena_bytes / this->block_size;
+        }
+        else
+        {
+            arena_huge_pages = false;
+        }
+    }
+
+    free_blocks.reserve(arena_blocks);
+    // Lowest addresses on top of the stack, so a lightly loaded server keeps touching the same pages.
+    for (size_t i = arena_blocks; i > 0; --i)
+    {
+        free_blocks.push_back(arena + (i - 1) * block_stride);
+    }
+}
+
+http::BufferPool::~BufferPool()
+{
+    for (size_t i = 0; i < free_large_blocks.size(); ++i)
+    {
+        for (const LargeBlock &block : free_large_blocks[i])
+        {
+            free_large(block, block_size << (i + 1));
+        }
+    }
+
+    if (arena && arena_mirrored)
+    {
+        unmap_mirrored_arena(arena, block_size, arena_blocks);
+    }
+    else if (arena)
+    {
+        unmap_arena(arena, arena_bytes, arena_huge_pages);
+    }
+}
+
+http::IoBuffer http::BufferPool::acquire(size_t min_size)
+{
+    size_t size_class = 0;
+    while (size_class < large_classes && (block_size << size_class) < min_size)
+    {
+        ++size_class;
+    }
+    if (size_class > 0)
+    {
+        return acquire_large(size_class);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        ++blocks_in_use;
+        peak_blocks_in_use = std::max(peak_blocks_in_use, blocks_in_use);
+        if (!free_blocks.empty())
+        {
+            char *block = free_blocks.back();
+            free_blocks.pop_back();
+            return IoBuffer(block, block_size, arena_mirrored);
+        }
+        ++heap_blocks_in_use;
+        ++heap_allocations;
+    }
+
+    try
+    {
+        return IoBuffer(new char[block_size], block_size);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        --blocks_in_use;
+        --heap_blocks_in_use;
+        throw;
+    }
+}
+
+http::IoBuffer http::BufferPool::acquire_large(size_t size_class)
+{
+    size_t size = block_size << size_class;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        ++blocks_in_use;
+        ++large_blocks_in_use;
+        peak_blocks_in_use = std::max(peak_blocks_in_use, blocks_in_use);
+        std::vector<LargeBlock> &cached = free_large_blocks[size_class - 1];
+        if (!cached.empty())
+        {
+            LargeBlock block = cached.back();
+            cached.pop_back();
+            return IoBuffer(block.data, size, block.mirrored);
+        }
+        ++large_allocations;
+    }
+
+    // Mapping happens outside the lock, it is slow compared to handing out cached blocks.
+    char *data = large_huge_pages ? nullptr : map_mirrored_arena(size, 1);
+    if (data)
+    {
+        return IoBuffer(data, size, true);
+    }
+    try
+    {
+        return IoBuffer(new char[size], size);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        --blocks_in_use;
+        --large_blocks_in_use;
+        throw;
+    }
+}
+
+void http::BufferPool::free_large(const LargeBlock &block, size_t size) noexcept
+{
+    if (block.mirrored)
+    {
+        unmap_mirrored_arena(block.data, size, 1);
+    }
+    else
+    {
+        delete[] block.data;
+    }
+}
+
+void http::BufferPool::release(IoBuffer &buffer) noexcept
+{
+    if (buffer.empty())
+    {
+        return;
+    }
+
+    char *block = buffer.data();
+    size_t size = buffer.size();
+    bool mirrored = buffer.mirrored();
+    buffer = IoBuffer();
+
+    if (size > block_size)
+    {
+        size_t size_class = 1;
+        while ((block_size << size_class) < size)
+        {
+            ++size_class;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            --blocks_in_use;
+            --large_blocks_in_use;
+            std::vector<LargeBlock> &cached = free_large_blocks[size_class - 1];
+            if (cached.size() < MAX_FREE_LARGE_BLOCKS)
+            {
+                cached.push_back(LargeBlock{block, mirrored});
+                return;
+            }
+        }
+        free_large(LargeBlock{block, mirrored}, size);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    --blocks_in_use;
+    if (owns(block))
+    {
+        free_blocks.push_back(block);
+        return;
+    }
+    --heap_blocks_in_use;
+    delete[] block;
+}
+
+http::BufferPoolStats http::BufferPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    BufferPoolStats stats;
+    stats.block_size = block_size;
+    stats.arena_blocks = arena_blocks;
+    stats.arena_bytes = arena_bytes;
+    stats.huge_pages = arena_huge_pages;
+    stats.mirrored = arena_mirrored;
+    stats.blocks_in_use = blocks_in_use;
+    stats.peak_blocks_in_use = peak_blocks_in_use;
+    stats.heap_blocks_in_use = heap_blocks_in_use;
+    stats.heap_allocations = heap_allocations;
+    stats.max_block_size = max_block_size();
+    stats.large_blocks_in_use = large_blocks_in_use;
+    stats.large_allocations = large_allocations;
+    return stats;
+}
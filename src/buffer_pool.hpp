@@ -0,0 +1,132 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include "http/http.hpp"
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+namespace http
+{
+    /// Fixed-size I/O block borrowed from a BufferPool, or a view of bytes inside one.
+    /// Non-owning: a default constructed IoBuffer is empty and has size 0.
+    /// A mirrored block is mapped twice back to back, so data()[i] and data()[i + size()]
+    /// are the same byte and any size() bytes starting inside the block are contiguous.
+    class IoBuffer
+    {
+    private:
+        char *data_ = nullptr;
+        size_t size_ = 0;
+        bool mirrored_ = false;
+
+    public:
+        IoBuffer() = default;
+        IoBuffer(char *data, size_t size, bool mirrored = false) noexcept : data_(data), size_(size), mirrored_(mirrored) {}
+
+        char *data() noexcept { return data_; }
+        const char *data() const noexcept { return data_; }
+        size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return data_ == nullptr; }
+        bool mirrored() const noexcept { return mirrored_; }
+
+        char &operator[](size_t index) noexcept { return data_[index]; }
+        const char &operator[](size_t index) const noexcept { return data_[index]; }
+
+        char *begin() noexcept { return data_; }
+        char *end() noexcept { return data_ + size_; }
+        const char *begin() const noexcept { return data_; }
+        const char *end() const noexcept { return data_ + size_; }
+    };
+
+    /// Server-wide pool of I/O blocks in power-of-two size classes.
+    /// Blocks of the base size are carved from one arena. Connections borrow a block only while
+    /// bytes are in flight and return it once idle, so idle connections hold no buffer memory.
+    /// When the arena is exhausted blocks are allocated from the heap and freed again on release.
+    /// Larger classes, up to max_block_size, serve connections that move a lot of data. They are
+    /// mapped on demand and a few per class are kept for reuse.
+    /// Unless huge pages are requested the arena and the larger blocks are mirrored where the
+    /// platform allows it, heap blocks never are.
+    class BufferPool
+    {
+    private:
+        size_t block_size;
+        char *arena = nullptr;
+        size_t arena_bytes = 0;
+        size_t arena_blocks = 0;
+        // Distance between blocks, twice the block size for a mirrored arena.
+        size_t block_stride = 0;
+        bool arena_huge_pages = false;
+        bool arena_mirrored = false;
+
+        // Number of size classes above the base size.
+        size_t large_classes = 0;
+        bool large_huge_pages = false;
+
+        struct LargeBlock
+        {
+            char *data;
+            bool mirrored;
+        };
+
+        mutable std::mutex pool_mutex;
+        std::vector<char *> free_blocks;
+        // Released larger blocks, indexed by size class - 1.
+        std::vector<std::vector<LargeBlock>> free_large_blocks;
+        size_t blocks_in_use = 0;
+        size_t peak_blocks_in_use = 0;
+        size_t heap_blocks_in_use = 0;
+        size_t heap_allocations = 0;
+        size_t large_blocks_in_use = 0;
+        size_t large_allocations = 0;
+
+        // Released blocks kept per larger size class, the rest is unmapped.
+        static const size_t MAX_FREE_LARGE_BLOCKS = 4;
+
+        IoBuffer acquire_large(size_t size_class);
+        static void free_large(const LargeBlock &block, size_t size) noexcept;
+
+        bool owns(const char *block) const noexcept
+        {
+            return block >= arena && block < arena + arena_blocks * block_stride;
+        }
+
+        /// Maps bytes for the arena, trying huge pages first if requested.
+        /// @param bytes In: requested size, out: mapped size (rounded up to the page size used).
+        /// @param huge_pages In: whether to try huge pages, out: whether the mapping uses them.
+        /// @return Arena base address, or nullptr if nothing could be mapped.
+        static char *map_arena(size_t &bytes, bool &huge_pages);
+        static void unmap_arena(char *arena, size_t bytes, bool huge_pages);
+        /// Maps block_count blocks that each appear twice in a row, see IoBuffer::mirrored().
+        /// @param block_size Block size, must be a multiple of the platform mapping granularity.
+        /// @return Arena base address, block i starts at 2 * i * block_size; nullptr if unsupported.
+        static char *map_mirrored_arena(size_t block_size, size_t block_count);
+        static void unmap_mirrored_arena(char *arena, size_t block_size, size_t block_count);
+
+    public:
+        /// @param block_size Size of the base blocks in bytes.
+        /// @param block_count Number of base blocks in the arena.
+        /// @param max_block_size Largest block handed out, rounded up to a power-of-two multiple of block_size.
+        /// @param huge_pages Back the arena with huge pages when the system has them available, instead of mirroring it.
+        BufferPool(size_t block_size, size_t block_count, size_t max_block_size, bool huge_pages);
+        ~BufferPool();
+
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+        /// @param min_size Requested capacity, blocks are never larger than max_block_size().
+        /// @return A block of the smallest size class holding min_size bytes; contents are unspecified.
+        IoBuffer acquire(size_t min_size = 0);
+        /// Returns a block to the pool and empties buffer. Empty buffers are ignored.
+        void release(IoBuffer &buffer) noexcept;
+
+        /// @return Size of the base blocks.
+        size_t base_block_size() const noexcept { return block_size; }
+        /// @return Size of the largest size class.
+        size_t max_block_size() const noexcept { return block_size << large_classes; }
+
+        BufferPoolStats stats() const;
+    };
+}
+
+#endif // BUFFER_POOL_HPP
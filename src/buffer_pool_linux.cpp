@@ -0,0 +1,104 @@
+#if defined(__linux__)
+
+#include "buffer_pool.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    // Default x86-64/aarch64 huge page size; MAP_HUGETLB mappings must be a multiple of it.
+    const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    size_t round_up(size_t bytes, size_t page_size)
+    {
+        return (bytes + page_size - 1) / page_size * page_size;
+    }
+}
+
+char *http::BufferPool::map_arena(size_t &bytes, bool &huge_pages)
+{
+    if (huge_pages)
+    {
+        size_t huge_bytes = round_up(bytes, HUGE_PAGE_SIZE);
+        void *memory = mmap(nullptr, huge_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            bytes = huge_bytes;
+            return static_cast<char *>(memory);
+        }
+        // No huge pages reserved (vm.nr_hugepages), fall back to regular pages.
+        huge_pages = false;
+    }
+
+    size_t page_bytes = round_up(bytes, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+    void *memory = mmap(nullptr, page_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    bytes = page_bytes;
+    return static_cast<char *>(memory);
+}
+
+void http::BufferPool::unmap_arena(char *arena, size_t bytes, bool huge_pages)
+{
+    (void)huge_pages;
+    munmap(arena, bytes);
+}
+
+char *http::BufferPool::map_mirrored_arena(size_t block_size, size_t block_count)
+{
+    if (block_size % static_cast<size_t>(sysconf(_SC_PAGESIZE)) != 0)
+    {
+        return nullptr;
+    }
+
+    // Both views of a block must share the same physical pages, so the memory comes from a memfd
+    // instead of an anonymous mapping.
+    int fd = memfd_create("http-io-buffers", MFD_CLOEXEC);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+    size_t bytes = block_size * block_count;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == -1)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // Reserve the whole address range first so the fixed mappings below cannot clobber anything else.
+    void *reserved = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    char *arena = static_cast<char *>(reserved);
+    for (size_t i = 0; i < block_count; ++i)
+    {
+        char *block = arena + 2 * i * block_size;
+        off_t offset = static_cast<off_t>(i * block_size);
+        if (mmap(block, block_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset) == MAP_FAILED ||
+            mmap(block + block_size, block_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset) == MAP_FAILED)
+        {
+            // Most likely vm.max_map_count, the caller falls back to a plain arena.
+            munmap(arena, 2 * bytes);
+            close(fd);
+            return nullptr;
+        }
+    }
+
+    // The mappings keep the memory alive.
+    close(fd);
+    return arena;
+}
+
+void http::BufferPool::unmap_mirrored_arena(char *arena, size_t block_size, size_t block_count)
+{
+    munmap(arena, 2 * block_size * block_count);
+}
+
+#endif
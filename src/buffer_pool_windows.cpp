@@ -0,0 +1,123 @@
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "buffer_pool.hpp"
+
+#include <windows.h>
+
+namespace
+{
+	size_t round_up(size_t bytes, size_t page_size)
+	{
+		return (bytes + page_size - 1) / page_size * page_size;
+	}
+}
+
+char *http::BufferPool::map_arena(size_t &bytes, bool &huge_pages)
+{
+	if (huge_pages)
+	{
+		// Needs SeLockMemoryPrivilege; without it the allocation fails and regular pages are used.
+		size_t large_page_size = GetLargePageMinimum();
+		if (large_page_size != 0)
+		{
+			size_t large_bytes = round_up(bytes, large_page_size);
+			void *memory = VirtualAlloc(nullptr, large_bytes, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory)
+			{
+				bytes = large_bytes;
+				return static_cast<char *>(memory);
+			}
+		}
+		huge_pages = false;
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	size_t page_bytes = round_up(bytes, info.dwPageSize);
+	void *memory = VirtualAlloc(nullptr, page_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (!memory)
+	{
+		return nullptr;
+	}
+	bytes = page_bytes;
+	return static_cast<char *>(memory);
+}
+
+void http::BufferPool::unmap_arena(char *arena, size_t bytes, bool huge_pages)
+{
+	(void)bytes;
+	(void)huge_pages;
+	VirtualFree(arena, 0, MEM_RELEASE);
+}
+
+char *http::BufferPool::map_mirrored_arena(size_t block_size, size_t block_count)
+{
+	// Views can only be placed on allocation granularity (64 KiB) boundaries, smaller blocks are not mirrored.
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	if (block_size % info.dwAllocationGranularity != 0)
+	{
+		return nullptr;
+	}
+
+	unsigned long long bytes = static_cast<unsigned long long>(block_size) * block_count;
+	HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes & 0xffffffff), nullptr);
+	if (!mapping)
+	{
+		return nullptr;
+	}
+
+	// There is no way to map a view over a reservation without VirtualAlloc2, so find a free range,
+	// release it and map into it, retrying if another thread took the range in between.
+	char *arena = nullptr;
+	for (int attempt = 0; attempt < 16 && !arena; ++attempt)
+	{
+		void *reserved = VirtualAlloc(nullptr, static_cast<SIZE_T>(2 * bytes), MEM_RESERVE, PAGE_NOACCESS);
+		if (!reserved)
+		{
+			break;
+		}
+		VirtualFree(reserved, 0, MEM_RELEASE);
+
+		char *base = static_cast<char *>(reserved);
+		size_t mapped = 0;
+		for (; mapped < 2 * block_count; ++mapped)
+		{
+			unsigned long long offset = static_cast<unsigned long long>(mapped / 2) * block_size;
+			void *view = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset & 0xffffffff), block_size, base + mapped * block_size);
+			if (!view)
+			{
+				break;
+			}
+		}
+		if (mapped == 2 * block_count)
+		{
+			arena = base;
+		}
+		else
+		{
+			for (size_t i = 0; i < mapped; ++i)
+			{
+				UnmapViewOfFile(base + i * block_size);
+			}
+		}
+	}
+
+	// The views keep the section alive.
+	CloseHandle(mapping);
+	return arena;
+}
+
+void http::BufferPool::unmap_mirrored_arena(char *arena, size_t block_size, size_t block_count)
+{
+	for (size_t i = 0; i < 2 * block_count; ++i)
+	{
+		UnmapViewOfFile(arena + i * block_size);
+	}
+}
+
+#endif
@@ -0,0 +1,231 @@
+#include "byte_ranges.hpp"
+
+#include "http/http_constants.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    // More ranges than this are answered with the whole body, which bounds the part headers many small ranges would add.
+    const size_t MAX_RANGES = 16;
+
+    const uint64_t MAX_POSITION = static_cast<uint64_t>(-1) / 10 - 1;
+
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    /// @brief Parses the digits in [position, end), saturating instead of overflowing.
+    /// @return False if there are none or anything else.
+    bool parse_position(const std::string &value, size_t position, size_t end, uint64_t &number)
+    {
+        if (position == end)
+        {
+            return false;
+        }
+        number = 0;
+        for (; position < end; ++position)
+        {
+            if (!std::isdigit(static_cast<unsigned char>(value[position])))
+            {
+                return false;
+            }
+            number = number > MAX_POSITION ? number : number * 10 + static_cast<uint64_t>(value[position] - '0');
+        }
+        return true;
+    }
+
+    std::string make_boundary()
+    {
+        thread_local std::mt19937_64 generator{std::random_device{}()};
+        char boundary[17];
+        snprintf(boundary, sizeof(boundary), "%016llx", static_cast<unsigned long long>(generator()));
+        return boundary;
+    }
+}
+
+http::ByteRanges::Result http::ByteRanges::parse(const std::string &range, uint64_t size, std::vector<Range> &ranges)
+{
+    ranges.clear();
+    size_t position = 0;
+    while (position < range.size() && is_space(range[position]))
+    {
+        ++position;
+    }
+    static const char UNIT[] = "bytes=";
+    for (size_t i = 0; i < sizeof(UNIT) - 1; ++i, ++position)
+    {
+        if (position == range.size() || std::tolower(static_cast<unsigned char>(range[position])) != UNIT[i])
+        {
+            return IGNORED;
+        }
+    }
+
+    size_t specs = 0;
+    while (position <= range.size())
+    {
+        size_t end = range.find(',', position);
+        if (end == std::string::npos)
+        {
+            end = range.size();
+        }
+        size_t spec_begin = position;
+        size_t spec_end = end;
+        position = end + 1;
+        while (spec_begin < spec_end && is_space(range[spec_begin]))
+        {
+            ++spec_begin;
+        }
+        while (spec_end > spec_begin && is_space(range[spec_end - 1]))
+        {
+            --spec_end;
+        }
+        if (spec_begin == spec_end)
+        {
+            continue; // Empty list elements are allowed.
+        }
+        if (++specs > MAX_RANGES)
+        {
+            return IGNORED;
+        }
+
+        size_t dash = range.find('-', spec_begin);
+        if (dash == std::string::npos || dash >= spec_end)
+        {
+            return IGNORED;
+        }
+        Range selected;
+        if (dash == spec_begin)
+        {
+            // Suffix range, the last n bytes.
+            uint64_t suffix_length;
+            if (!parse_position(range, dash + 1, spec_end, suffix_length))
+            {
+                return IGNORED;
+            }
+            if (suffix_length == 0 || size == 0)
+            {
+                continue;
+            }
+            selected.first = suffix_length < size ? size - suffix_length : 0;
+            selected.last = size - 1;
+        }
+        else
+        {
+            if (!parse_position(range, spec_begin, dash, selected.first))
+            {
+                return IGNORED;
+            }
+            selected.last = size == 0 ? 0 : size - 1;
+            if (dash + 1 < spec_end)
+            {
+                uint64_t last;
+                if (!parse_position(range, dash + 1, spec_end, last) || last < selected.first)
+                {
+                    return IGNORED;
+                }
+                selected.last = last < selected.last ? last : selected.last;
+            }
+            if (selected.first >= size)
+            {
+                continue;
+            }
+        }
+        ranges.push_back(selected);
+    }
+    if (specs == 0)
+    {
+        return IGNORED;
+    }
+
+    // Overlapping or adjacent ranges are coalesced (RFC 7233 section 6.1), so the selected bytes never exceed the body.
+    std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b)
+              { return a.first < b.first; });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); ++i)
+    {
+        if (ranges[i].first <= ranges[merged].last + 1)
+        {
+            ranges[merged].last = ranges[i].last > ranges[merged].last ? ranges[i].last : ranges[merged].last;
+        }
+        else
+        {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    if (!ranges.empty())
+    {
+        ranges.resize(merged + 1);
+    }
+    return ranges.empty() ? NOT_SATISFIABLE : SATISFIABLE;
+}
+
+bool http::ByteRanges::if_range_matches(const std::string &if_range, const std::unordered_map<std::string, std::string> &response_headers)
+{
+    size_t begin = 0;
+    size_t end = if_range.size();
+    while (begin < end && is_space(if_range[begin]))
+    {
+        ++begin;
+    }
+    while (end > begin && is_space(if_range[end - 1]))
+    {
+        --end;
+    }
+    std::string validator = if_range.substr(begin, end - begin);
+    if (validator.empty() || validator.compare(0, 2, "W/") == 0)
+    {
+        return false;
+    }
+    // Only strong validators may combine ranges of different responses.
+    const std::string &header = validator[0] == '"' ? http::headers::ETAG : http::headers::LAST_MODIFIED;
+    auto value = response_headers.find(header);
+    return value != response_headers.end() && value->second == validator;
+}
+
+std::string http::ByteRanges::content_range(const Range &range, uint64_t size)
+{
+    return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+}
+
+std::string http::ByteRanges::unsatisfied_range(uint64_t size)
+{
+    return "bytes */" + std::to_string(size);
+}
+
+std::vector<http::BodyPart> http::ByteRanges::select(const std::vector<Range> &ranges, uint64_t size, const std::string &content_type, std::string &parts_content_type)
+{
+    std::vector<BodyPart> parts(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        parts[i].offset = ranges[i].first;
+        parts[i].length = ranges[i].last - ranges[i].first + 1;
+    }
+    if (ranges.size() == 1)
+    {
+        return parts;
+    }
+
+    std::string boundary = make_boundary();
+    parts_content_type = "multipart/byteranges; boundary=" + boundary;
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        std::string &prefix = parts[i].prefix;
+        prefix = i == 0 ? "--" : "\r\n--";
+        prefix += boundary;
+        prefix += "\r\n";
+        if (!content_type.empty())
+        {
+            prefix += "Content-Type: " + content_type + "\r\n";
+        }
+        prefix += "Content-Range: " + content_range(ranges[i], size) + "\r\n\r\n";
+    }
+    BodyPart closing;
+    closing.prefix = "\r\n--" + boundary + "--\r\n";
+    parts.push_back(closing);
+    return parts;
+}
@@ -0,0 +1,59 @@
+#ifndef BYTE_RANGES_HPP
+#define BYTE_RANGES_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace http
+{
+    /// A piece of a selected response body: bytes sent from memory, then length body bytes starting at offset.
+    struct BodyPart
+    {
+        /// Sent before the body bytes, e.g. the boundary and headers of a multipart/byteranges part.
+        std::string prefix;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    /// Byte range requests (RFC 7233): Range parsing, If-Range validation and multipart/byteranges framing.
+    struct ByteRanges
+    {
+        /// Inclusive range of body bytes.
+        struct Range
+        {
+            uint64_t first = 0;
+            uint64_t last = 0;
+        };
+
+        enum Result
+        {
+            /// The header is malformed, not in bytes or asks for too many ranges; the whole body is sent.
+            IGNORED,
+            /// At least one range overlaps the body, it is answered with 206 Partial Content.
+            SATISFIABLE,
+            /// No range overlaps the body, it is answered with 416 Range Not Satisfiable.
+            NOT_SATISFIABLE
+        };
+
+        /// @brief Parses a Range header against a body of size bytes.
+        /// @param ranges Filled with the satisfiable ranges clamped to the body, in body order with overlapping or adjacent ones coalesced.
+        static Result parse(const std::string &range, uint64_t size, std::vector<Range> &ranges);
+
+        /// @brief Checks an If-Range header against the response's validators.
+        /// An entity tag has to equal a strong ETag, a date has to equal Last-Modified.
+        static bool if_range_matches(const std::string &if_range, const std::unordered_map<std::string, std::string> &response_headers);
+
+        /// @return Content-Range value for a range of a body of size bytes, or for none ("bytes */size").
+        static std::string content_range(const Range &range, uint64_t size);
+        static std::string unsatisfied_range(uint64_t size);
+
+        /// @brief Splits a body into the parts sending the ranges, as one part or as multipart/byteranges.
+        /// @param content_type Content-Type of the body, repeated in every part of a multipart body.
+        /// @param parts_content_type Set to the Content-Type of the selected body, unchanged for a single range.
+        static std::vector<BodyPart> select(const std::vector<Range> &ranges, uint64_t size, const std::string &content_type, std::string &parts_content_type);
+    };
+}
+
+#endif // BYTE_RANGES_HPP
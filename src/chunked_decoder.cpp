@@ -0,0 +1,179 @@
+#include "chunked_decoder.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    // Sizes above this are rejected before they can overflow, no body gets anywhere near it.
+    const uint64_t MAX_CHUNK_SIZE = uint64_t(1) << 60;
+
+    int hex_value(char c) noexcept
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+}
+
+http::ChunkedDecoder::Status http::ChunkedDecoder::decode(const char *data, size_t size, size_t &cursor, Span &span) noexcept
+{
+    while (cursor < size)
+    {
+        if (state == CHUNK_DATA)
+        {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(size - cursor, remaining));
+            span.offset = cursor;
+            span.length = length;
+            cursor += length;
+            remaining -= length;
+            if (remaining == 0)
+            {
+                state = DATA_CR;
+            }
+            return DATA;
+        }
+
+        char c = data[cursor];
+        switch (state)
+        {
+        case SIZE:
+        {
+            int digit = hex_value(c);
+            if (digit >= 0)
+            {
+                if (chunk_size > (MAX_CHUNK_SIZE >> 4))
+                {
+                    state = FAILED;
+                }
+                chunk_size = chunk_size * 16 + static_cast<uint64_t>(digit);
+                ++size_digits;
+            }
+            else if (size_digits == 0)
+            {
+                state = FAILED;
+            }
+            else if (c == ';' || c == ' ' || c == '\t')
+            {
+                state = EXTENSION;
+            }
+            else if (c == '\r')
+            {
+                state = SIZE_LF;
+            }
+            else
+            {
+                state = FAILED;
+            }
+            break;
+        }
+        case EXTENSION:
+            // Extensions are not interpreted, only the end of the line matters.
+            if (c == '\r')
+            {
+                state = SIZE_LF;
+            }
+            else if (c == '\n')
+            {
+                state = FAILED;
+            }
+            break;
+        case SIZE_LF:
+            if (c != '\n')
+            {
+                state = FAILED;
+            }
+            else if (chunk_size == 0)
+            {
+                state = TRAILER_START;
+                framing_bytes = 0;
+            }
+            else
+            {
+                state = CHUNK_DATA;
+                remaining = chunk_size;
+            }
+            break;
+        case DATA_CR:
+            state = c == '\r' ? DATA_LF : FAILED;
+            break;
+        case DATA_LF:
+            if (c == '\n')
+            {
+                state = SIZE;
+                chunk_size = 0;
+                size_digits = 0;
+                framing_bytes = 0;
+            }
+            else
+            {
+                state = FAILED;
+            }
+            break;
+        case TRAILER_START:
+            // An empty line ends the body, anything else is a trailer field that is skipped.
+            if (c == '\r')
+            {
+                state = FINAL_LF;
+            }
+            else if (c == '\n' || c == ' ' || c == '\t')
+            {
+                state = FAILED;
+            }
+            else
+            {
+                state = TRAILER;
+            }
+            break;
+        case TRAILER:
+            if (c == '\r')
+            {
+                state = TRAILER_LF;
+            }
+            else if (c == '\n')
+            {
+                state = FAILED;
+            }
+            break;
+        case TRAILER_LF:
+            state = c == '\n' ? TRAILER_START : FAILED;
+            break;
+        case FINAL_LF:
+            if (c != '\n')
+            {
+                state = FAILED;
+                break;
+            }
+            state = COMPLETE;
+            ++cursor;
+            return DONE;
+        case COMPLETE:
+            return DONE;
+        case CHUNK_DATA:
+        case FAILED:
+            break;
+        }
+
+        if (state == FAILED || ++framing_bytes > max_framing_bytes)
+        {
+            state = FAILED;
+            return INVALID;
+        }
+        ++cursor;
+    }
+
+    if (state == COMPLETE)
+    {
+        return DONE;
+    }
+    return state == FAILED ? INVALID : NEED_MORE_DATA;
+}
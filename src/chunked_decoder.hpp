@@ -0,0 +1,85 @@
+#ifndef CHUNKED_DECODER_HPP
+#define CHUNKED_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace http
+{
+    /// Incremental decoder for a chunked transfer-coded request body.
+    /// Works on bytes in place: framing (size lines, extensions, CRLFs, trailers) is skipped and
+    /// chunk data is reported as spans of the caller's buffer, nothing is copied or allocated.
+    /// Chunk extensions and trailer fields are validated for line structure and then discarded.
+    class ChunkedDecoder
+    {
+    public:
+        enum Status
+        {
+            /// All input was consumed without completing a data span or the body.
+            NEED_MORE_DATA,
+            /// A span of chunk data was found, see Span.
+            DATA,
+            /// The last chunk and the trailer section were consumed.
+            DONE,
+            /// The input is not valid chunked encoding, or a framing line exceeds the limit.
+            INVALID
+        };
+
+        /// Chunk data inside the buffer passed to decode().
+        struct Span
+        {
+            size_t offset;
+            size_t length;
+        };
+
+    private:
+        enum State
+        {
+            SIZE,
+            EXTENSION,
+            SIZE_LF,
+            CHUNK_DATA,
+            DATA_CR,
+            DATA_LF,
+            TRAILER_START,
+            TRAILER,
+            TRAILER_LF,
+            FINAL_LF,
+            COMPLETE,
+            FAILED
+        };
+
+        State state = SIZE;
+        uint64_t chunk_size = 0;
+        unsigned int size_digits = 0;
+        uint64_t remaining = 0;
+        // Framing bytes of the current size line, or of the whole trailer section.
+        size_t framing_bytes = 0;
+        size_t max_framing_bytes = 0;
+
+    public:
+        /// @param max_framing_bytes Longest accepted chunk size line, extensions included, and longest trailer section.
+        explicit ChunkedDecoder(size_t max_framing_bytes = 8192) noexcept : max_framing_bytes(max_framing_bytes) {}
+
+        /// Starts a new body.
+        void reset(size_t max_framing_bytes) noexcept
+        {
+            *this = ChunkedDecoder(max_framing_bytes);
+        }
+
+        /// Consumes bytes from data[cursor, size) up to and including the next chunk data span.
+        /// @param data Buffer holding the encoded body.
+        /// @param size End of the valid bytes in data.
+        /// @param cursor In: first unconsumed byte, out: first byte not consumed by this call.
+        /// @param span Set when DATA is returned; the span ends at the new cursor.
+        Status decode(const char *data, size_t size, size_t &cursor, Span &span) noexcept;
+
+        /// @return Bytes of the current chunk not yet reported as data.
+        uint64_t remaining_in_chunk() const noexcept
+        {
+            return remaining;
+        }
+    };
+}
+
+#endif // CHUNKED_DECODER_HPP
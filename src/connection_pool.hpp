@@ -0,0 +1,127 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include "http_connection.hpp"
+#include "buffer_pool.hpp"
+#include "response_header_cache.hpp"
+#include "tcp.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace http
+{
+    /// Reference to a pooled connection that can be checked against slot reuse.
+    struct ConnectionHandle
+    {
+        HttpConnection *connection;
+        uint32_t generation;
+    };
+
+    /// Preallocated slab of HttpConnection objects recycled through a free list.
+    /// Slots keep their request/response allocations across connections, so
+    /// acquiring and releasing a slot is O(1) and does not touch the heap. Each release
+    /// bumps the slot generation, which makes handles taken before the release stale.
+    /// Acquire and release are meant for the event loop thread; handle() may be called by
+    /// any thread that currently works on the connection.
+    class ConnectionPool
+    {
+    private:
+        std::vector<HttpConnection> slots;
+        std::vector<uint32_t> generations;
+        std::vector<char> in_use;
+        // Indices of unused slots, the most recently released one is reused first while its memory is warm.
+        std::vector<size_t> free_slots;
+        size_t active = 0;
+
+        size_t slot_of(const HttpConnection &connection) const noexcept
+        {
+            return static_cast<size_t>(&connection - slots.data());
+        }
+
+    public:
+        /// @param capacity Number of slots, allocated up front.
+        /// @param buffer_pool Pool the connections borrow their I/O buffers from.
+        /// @param config Server configuration, must outlive the pool.
+        /// @param header_cache Shared Date and Server lines, must outlive the pool.
+        ConnectionPool(size_t capacity, BufferPool &buffer_pool, const HttpServerConfig &config, const ResponseHeaderCache &header_cache) : generations(capacity, 0), in_use(capacity, 0)
+        {
+            slots.reserve(capacity);
+            free_slots.reserve(capacity);
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                slots.emplace_back(tcp::ConnectionSocket(tcp::constants::INVALID_HANDLE, 0, 0), buffer_pool, config, header_cache);
+                free_slots.push_back(capacity - 1 - i);
+            }
+        }
+
+        ConnectionPool(const ConnectionPool &) = delete;
+        ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+        /// Takes a free slot for a newly accepted socket.
+        /// @return The connection, or nullptr if every slot is in use (the socket is closed then).
+        HttpConnection *acquire(tcp::ConnectionSocket &&socket)
+        {
+            if (free_slots.empty())
+            {
+                return nullptr;
+            }
+            size_t slot = free_slots.back();
+            free_slots.pop_back();
+            in_use[slot] = 1;
+            ++active;
+            slots[slot].open(std::move(socket));
+            return &slots[slot];
+        }
+
+        /// Closes the connection and returns its slot to the free list.
+        /// @return False if the handle is stale, i.e. the connection was already released.
+        bool release(const ConnectionHandle &handle)
+        {
+            size_t slot = slot_of(*handle.connection);
+            if (!in_use[slot] || generations[slot] != handle.generation)
+            {
+                return false;
+            }
+            slots[slot].close();
+            ++generations[slot];
+            in_use[slot] = 0;
+            --active;
+            free_slots.push_back(slot);
+            return true;
+        }
+
+        /// @return Handle for a connection currently in use.
+        ConnectionHandle handle(HttpConnection &connection) const noexcept
+        {
+            return ConnectionHandle{&connection, generations[slot_of(connection)]};
+        }
+
+        /// Calls function for every connection in use.
+        template <typename Function>
+        void for_each(Function function)
+        {
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                if (in_use[i])
+                {
+                    function(slots[i]);
+                }
+            }
+        }
+
+        /// @return Number of slots in use.
+        size_t size() const noexcept
+        {
+            return active;
+        }
+
+        /// @return Total number of slots.
+        size_t capacity() const noexcept
+        {
+            return slots.size();
+        }
+    };
+}
+
+#endif // CONNECTION_POOL_HPP
@@ -98,6 +98,12 @@ namespace http
         }
 
         size_t get_next(std::vector<char> &buffer, size_t buffer_cursor = 0, size_t max_size = std::numeric_limits<size_t>::max())
+        {
+            return get_next(buffer.data(), buffer.size(), buffer_cursor, max_size);
+        }
+
+        /// Same as get_next(std::vector<char> &, ...) for a raw buffer of buffer_size bytes.
+        size_t get_next(char *buffer, size_t buffer_size, size_t buffer_cursor = 0, size_t max_size = std::numeric_limits<size_t>::max())
         {
             try
             {
@@ -130,7 +136,7 @@ namespace http
                     return 0; // No more data available after provider read
                 }
 
-                if (buffer_cursor >= buffer.size())
+                if (buffer_cursor >= buffer_size)
                 {
                     throw std::out_of_range("DataStream: Buffer cursor is out of bounds.");
                 }
@@ -140,10 +146,10 @@ namespace http
                     return 0;
                 }
 
-                size_t bytes_to_read = std::min(buffer.size() - buffer_cursor, available_data_size - current_cursor);
+                size_t bytes_to_read = std::min(buffer_size - buffer_cursor, available_data_size - current_cursor);
                 bytes_to_read = std::min(bytes_to_read, max_size);
 
-                std::memcpy(buffer.data() + buffer_cursor, view.data + current_cursor, bytes_to_read);
+                std::memcpy(buffer + buffer_cursor, view.data + current_cursor, bytes_to_read);
                 advance_cursor(bytes_to_read);
                 return bytes_to_read;
             }
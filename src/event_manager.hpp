@@ -1,8 +1,6 @@
 #ifndef EVENT_MANAGER_HPP
 #define EVENT_MANAGER_HPP
 
-#include <vector>
-#include <unordered_map>
 #include <stdexcept>
 #include <ctime>
 #include <string>
@@ -17,6 +15,17 @@ namespace tcp
         WRITABLE = 2
     };
 
+    /// How a registered socket keeps reporting readiness.
+    enum trigger_mode
+    {
+        /// Reported on every wait while the socket is ready.
+        LEVEL_TRIGGERED,
+        /// Reported once per readiness change, the owner must drain the socket.
+        EDGE_TRIGGERED,
+        /// Reported once, then disabled until re-armed; lets another thread own the socket in between.
+        ONE_SHOT
+    };
+
     namespace exceptions
     {
         class CanNotCreateEventManager : public std::runtime_error
@@ -50,13 +59,33 @@ namespace tcp
         };
     }
 
+    /// Readiness reported by the OS event backend for one registered socket.
+    struct SocketEvent
+    {
+        /// Token passed when the socket was registered.
+        void *token;
+        /// socket_status bit flags.
+        int status;
+
+        bool is_readable() const noexcept
+        {
+            return status & socket_status::READABLE;
+        }
+
+        bool is_writable() const noexcept
+        {
+            return status & socket_status::WRITABLE;
+        }
+    };
+
     /// Cross-platform event poller wrapper (epoll/wepoll via pimpl).
+    /// Ready events are written into an array allocated once at construction and carry the
+    /// caller's token, so waiting and dispatching need no allocations or lookups.
     class EventManager
     {
         struct Impl;
         Impl *pimpl;
 
-        std::unordered_map<int, int> status;
         int max_events;
         time_t timeout;
 
@@ -70,24 +99,29 @@ namespace tcp
         EventManager(EventManager &&other) noexcept;
         EventManager &operator=(EventManager &&other) noexcept;
 
-        /// Registers socket for readability notifications and returns backend registration id.
-        int register_for_read(const int fd);
-        /// Registers socket for writability notifications and returns backend registration id.
-        int register_for_write(const int fd);
-        /// Removes a previously registered socket id from backend polling.
-        void remove_socket(const int id);
+        /// Registers socket for readability notifications, token is handed back with every event of this socket.
+        void register_for_read(const int fd, void *token, const trigger_mode mode = trigger_mode::EDGE_TRIGGERED);
+        /// Registers socket for writability notifications, token is handed back with every event of this socket.
+        void register_for_write(const int fd, void *token, const trigger_mode mode = trigger_mode::LEVEL_TRIGGERED);
+        /// Re-enables a ONE_SHOT read registration after its event was consumed.
+        void rearm_for_read(const int fd, void *token);
+        /// Re-enables a ONE_SHOT write registration after its event was consumed.
+        void rearm_for_write(const int fd, void *token);
+        /// Removes a previously registered socket from backend polling.
+        /// Closing a socket removes it as well, so sockets about to be closed need no explicit removal.
+        void remove_socket(const int fd);
 
         ~EventManager();
 
-        /// Blocks until events are available or timeout expires, then returns ready ids.
-        std::vector<int> wait_for_events();
+        /// Blocks until events are available or timeout expires.
+        /// @return Number of ready events, readable through event() until the next wait.
+        int wait_for_events();
+        /// Same as wait_for_events() but waits at most wait_timeout for this call only (0 polls without blocking).
+        int wait_for_events(const time_t wait_timeout);
 
-        /// True if last wait reported readable readiness for this id.
-        const bool is_readable(const int id) const;
-        /// True if last wait reported writable readiness for this id.
-        const bool is_writable(const int id) const;
-        /// Clears cached readiness flags for this id after event handling.
-        void clear_status(const int id);
+        /// @param index Position in [0, count) where count was returned by the last wait.
+        /// @return Token and readiness of the event at index.
+        SocketEvent event(const int index) const noexcept;
     };
 }
 
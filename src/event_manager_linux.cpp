@@ -5,6 +5,7 @@
 #include <sys/epoll.h>
 #include <unistd.h>
 
+#include <vector>
 #include <cstring>
 #include <cerrno>
 
@@ -12,9 +13,27 @@ namespace tcp
 {
     using Event = struct epoll_event;
 
+    namespace
+    {
+        uint32_t trigger_flags(const trigger_mode mode)
+        {
+            switch (mode)
+            {
+            case trigger_mode::EDGE_TRIGGERED:
+                return EPOLLET;
+            case trigger_mode::ONE_SHOT:
+                return EPOLLET | EPOLLONESHOT;
+            default:
+                return 0;
+            }
+        }
+    }
+
     struct EventManager::Impl
     {
         int epoll_fd;
+        // Filled by epoll_wait, sized once to max_events.
+        std::vector<Event> events;
 
         Impl() : epoll_fd(-1) {}
     };
@@ -22,15 +41,17 @@ namespace tcp
     EventManager::EventManager(const int max_events, const time_t timeout) : max_events(max_events), timeout(timeout)
     {
         pimpl = new Impl();
-        pimpl->epoll_fd = epoll_create1(0);
+        pimpl->events.resize(max_events);
+        pimpl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
         if (pimpl->epoll_fd == -1)
         {
             int error = errno;
+            delete pimpl;
             throw exceptions::CanNotCreateEventManager("Failed to create epoll instance: " + std::string(strerror(error)));
         }
     }
 
-    EventManager::EventManager(EventManager &&other) noexcept : pimpl(other.pimpl), status(std::move(other.status)), max_events(other.max_events), timeout(other.timeout)
+    EventManager::EventManager(EventManager &&other) noexcept : pimpl(other.pimpl), max_events(other.max_events), timeout(other.timeout)
     {
         other.pimpl = nullptr;
     }
@@ -39,30 +60,31 @@ namespace tcp
     {
         if (this != &other)
         {
-            close(pimpl->epoll_fd);
-            pimpl->epoll_fd = other.pimpl->epoll_fd;
-            status = std::move(other.status);
+            if (pimpl)
+            {
+                close(pimpl->epoll_fd);
+            }
+            delete pimpl;
+            pimpl = other.pimpl;
             max_events = other.max_events;
             timeout = other.timeout;
-            other.pimpl->epoll_fd = -1;
+            other.pimpl = nullptr;
         }
         return *this;
     }
 
-    int EventManager::register_for_read(const int fd)
+    void EventManager::register_for_read(const int fd, void *token, const trigger_mode mode)
     {
         try
         {
             Event ev;
-            ev.events = EPOLLIN | EPOLLET;
-            ev.data.fd = fd;
+            ev.events = EPOLLIN | trigger_flags(mode);
+            ev.data.ptr = token;
             if (epoll_ctl(pimpl->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
             {
                 int error = errno;
                 throw exceptions::CanNotRegisterSocket("Failed to register socket: " + std::string(strerror(error)));
             }
-            status[fd] = socket_status::WRITABLE;
-            return fd;
         }
         catch (tcp::exceptions::CanNotRegisterSocket &)
         {
@@ -78,20 +100,18 @@ namespace tcp
         }
     }
 
-    int EventManager::register_for_write(const int fd)
+    void EventManager::register_for_write(const int fd, void *token, const trigger_mode mode)
     {
         try
         {
             Event ev;
-            ev.events = EPOLLOUT;
-            ev.data.fd = fd;
+            ev.events = EPOLLOUT | trigger_flags(mode);
+            ev.data.ptr = token;
             if (epoll_ctl(pimpl->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
             {
                 int error = errno;
                 throw exceptions::CanNotRegisterSocket("Failed to register socket: " + std::string(strerror(error)));
             }
-            status[fd] = socket_status::WRITABLE;
-            return fd;
         }
         catch (tcp::exceptions::CanNotRegisterSocket &)
         {
@@ -107,95 +127,128 @@ namespace tcp
         }
     }
 
-    void EventManager::remove_socket(const int id)
+    void EventManager::rearm_for_read(const int fd, void *token)
     {
         try
         {
-            if (epoll_ctl(pimpl->epoll_fd, EPOLL_CTL_DEL, id, nullptr) == -1)
+            Event ev;
+            ev.events = EPOLLIN | trigger_flags(trigger_mode::ONE_SHOT);
+            ev.data.ptr = token;
+            if (epoll_ctl(pimpl->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1)
             {
                 int error = errno;
-                throw exceptions::CanNotRemoveSocket("Failed to remove socket: " + std::string(strerror(error)));
+                throw exceptions::CanNotModifySocket("Failed to modify socket: " + std::string(strerror(error)));
             }
-            status.erase(id);
         }
-        catch (tcp::exceptions::CanNotRemoveSocket &)
+        catch (tcp::exceptions::CanNotModifySocket &)
         {
             throw;
         }
         catch (std::exception &e)
         {
-            throw tcp::exceptions::CanNotRemoveSocket("Failed to remove socket: " + std::string(e.what()));
+            throw tcp::exceptions::CanNotModifySocket("Failed to modify socket: " + std::string(e.what()));
         }
         catch (...)
         {
-            throw tcp::exceptions::CanNotRemoveSocket("Failed to remove socket: Unknown error");
+            throw tcp::exceptions::CanNotModifySocket("Failed to modify socket: Unknown error");
         }
     }
 
-    EventManager::~EventManager()
+    void EventManager::rearm_for_write(const int fd, void *token)
     {
-        if (pimpl)
+        try
         {
-            close(pimpl->epoll_fd);
+            Event ev;
+            ev.events = EPOLLOUT | trigger_flags(trigger_mode::ONE_SHOT);
+            ev.data.ptr = token;
+            if (epoll_ctl(pimpl->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1)
+            {
+                int error = errno;
+                throw exceptions::CanNotModifySocket("Failed to modify socket: " + std::string(strerror(error)));
+            }
+        }
+        catch (tcp::exceptions::CanNotModifySocket &)
+        {
+            throw;
+        }
+        catch (std::exception &e)
+        {
+            throw tcp::exceptions::CanNotModifySocket("Failed to modify socket: " + std::string(e.what()));
+        }
+        catch (...)
+        {
+            throw tcp::exceptions::CanNotModifySocket("Failed to modify socket: Unknown error");
         }
-        delete pimpl;
     }
 
-    std::vector<int> EventManager::wait_for_events()
+    void EventManager::remove_socket(const int fd)
     {
         try
         {
-            std::vector<Event> events(max_events);
-            int num_events = epoll_wait(pimpl->epoll_fd, events.data(), max_events, timeout);
-            if (num_events == -1)
+            if (epoll_ctl(pimpl->epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == -1)
             {
                 int error = errno;
-                throw exceptions::CanNotWaitForEvents("Failed to wait for events: " + std::string(strerror(error)));
-            }
-            std::vector<int> fds;
-            for (int i = 0; i < num_events; ++i)
-            {
-                int fd = events[i].data.fd;
-                if (events[i].events & EPOLLIN)
-                {
-                    status[fd] |= socket_status::READABLE;
-                }
-                if (events[i].events & EPOLLOUT)
-                {
-                    status[fd] |= socket_status::WRITABLE;
-                }
-                fds.push_back(fd);
+                throw exceptions::CanNotRemoveSocket("Failed to remove socket: " + std::string(strerror(error)));
             }
-            return fds;
         }
-        catch (tcp::exceptions::CanNotWaitForEvents &)
+        catch (tcp::exceptions::CanNotRemoveSocket &)
         {
             throw;
         }
         catch (std::exception &e)
         {
-            throw tcp::exceptions::CanNotWaitForEvents("Failed to wait for events: " + std::string(e.what()));
+            throw tcp::exceptions::CanNotRemoveSocket("Failed to remove socket: " + std::string(e.what()));
         }
         catch (...)
         {
-            throw tcp::exceptions::CanNotWaitForEvents("Failed to wait for events: Unknown error");
+            throw tcp::exceptions::CanNotRemoveSocket("Failed to remove socket: Unknown error");
+        }
+    }
+
+    EventManager::~EventManager()
+    {
+        if (pimpl)
+        {
+            close(pimpl->epoll_fd);
         }
+        delete pimpl;
     }
 
-    const bool EventManager::is_readable(const int id) const
+    int EventManager::wait_for_events()
     {
-        return status.at(id) & socket_status::READABLE;
+        return wait_for_events(timeout);
     }
 
-    const bool EventManager::is_writable(const int id) const
+    int EventManager::wait_for_events(const time_t wait_timeout)
     {
-        return status.at(id) & socket_status::WRITABLE;
+        int num_events = epoll_wait(pimpl->epoll_fd, pimpl->events.data(), max_events, static_cast<int>(wait_timeout));
+        if (num_events == -1)
+        {
+            int error = errno;
+            if (error == EINTR)
+            {
+                return 0;
+            }
+            throw exceptions::CanNotWaitForEvents("Failed to wait for events: " + std::string(strerror(error)));
+        }
+        return num_events;
     }
 
-    void EventManager::clear_status(const int id)
+    SocketEvent EventManager::event(const int index) const noexcept
     {
-        status[id] = socket_status::IDLE;
+        const Event &ev = pimpl->events[index];
+        int status = socket_status::IDLE;
+        // Errors and hang-ups are reported as readiness so the owner's next I/O call surfaces them.
+        if (ev.events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+        {
+            status |= socket_status::READABLE;
+        }
+        if (ev.events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+        {
+            status |= socket_status::WRITABLE;
+        }
+        return SocketEvent{ev.data.ptr, status};
     }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -9,6 +9,8 @@
 
 #include <winsock2.h>
 
+#include <vector>
+
 namespace
 {
 	std::string wsa_error_message(const std::string &prefix)
@@ -19,10 +21,20 @@ namespace
 
 namespace tcp
 {
+	namespace
+	{
+		// wepoll is level-triggered only; one-shot registrations are still honoured.
+		uint32_t trigger_flags(const trigger_mode mode)
+		{
+			return mode == trigger_mode::ONE_SHOT ? EPOLLONESHOT : 0;
+		}
+	}
 
 	struct EventManager::Impl
 	{
 		HANDLE epoll_handle;
+		// Filled by epoll_wait, sized once to max_events.
+		std::vector<epoll_event> events;
 
 		Impl() : epoll_handle(nullptr) {}
 	};
@@ -30,9 +42,11 @@ namespace tcp
 	EventManager::EventManager(const int max_events, const time_t timeout) : max_events(max_events), timeout(timeout)
 	{
 		pimpl = new Impl();
+		pimpl->events.resize(max_events);
 		HANDLE handle = epoll_create1(0);
 		if (handle == nullptr)
 		{
+			delete pimpl;
 			throw exceptions::CanNotCreateEventManager(wsa_error_message("Failed to create epoll instance: "));
 		}
 		pimpl->epoll_handle = handle;
@@ -51,30 +65,27 @@ namespace tcp
 			if (pimpl && pimpl->epoll_handle)
 				epoll_close(pimpl->epoll_handle);
 
-			pimpl->epoll_handle = other.pimpl->epoll_handle;
-			status = std::move(other.status);
+			delete pimpl;
+			pimpl = other.pimpl;
 			max_events = other.max_events;
 			timeout = other.timeout;
-			other.pimpl->epoll_handle = nullptr;
+			other.pimpl = nullptr;
 		}
 		return *this;
 	}
 
-	int EventManager::register_for_read(const int fd)
+	void EventManager::register_for_read(const int fd, void *token, const trigger_mode mode)
 	{
 		try
 		{
 			epoll_event ev{};
-			ev.events = EPOLLIN;
-			ev.data.fd = fd;
+			ev.events = EPOLLIN | trigger_flags(mode);
+			ev.data.ptr = token;
 
 			if (epoll_ctl(pimpl->epoll_handle, EPOLL_CTL_ADD, static_cast<SOCKET>(fd), &ev) != 0)
 			{
 				throw exceptions::CanNotRegisterSocket(wsa_error_message("Failed to register socket: "));
 			}
-
-			status[fd] = socket_status::WRITABLE;
-			return fd;
 		}
 		catch (exceptions::CanNotRegisterSocket &)
 		{
@@ -90,21 +101,18 @@ namespace tcp
 		}
 	}
 
-	int EventManager::register_for_write(const int fd)
+	void EventManager::register_for_write(const int fd, void *token, const trigger_mode mode)
 	{
 		try
 		{
 			epoll_event ev{};
-			ev.events = EPOLLOUT;
-			ev.data.fd = fd;
+			ev.events = EPOLLOUT | trigger_flags(mode);
+			ev.data.ptr = token;
 
 			if (epoll_ctl(pimpl->epoll_handle, EPOLL_CTL_ADD, static_cast<SOCKET>(fd), &ev) != 0)
 			{
 				throw exceptions::CanNotRegisterSocket(wsa_error_message("Failed to register socket: "));
 			}
-
-			status[fd] = socket_status::WRITABLE;
-			return fd;
 		}
 		catch (exceptions::CanNotRegisterSocket &)
 		{
@@ -120,99 +128,123 @@ namespace tcp
 		}
 	}
 
-	void EventManager::remove_socket(const int id)
+	void EventManager::rearm_for_read(const int fd, void *token)
 	{
 		try
 		{
-			if (epoll_ctl(pimpl->epoll_handle, EPOLL_CTL_DEL, static_cast<SOCKET>(id), nullptr) != 0)
+			epoll_event ev{};
+			ev.events = EPOLLIN | trigger_flags(trigger_mode::ONE_SHOT);
+			ev.data.ptr = token;
+
+			if (epoll_ctl(pimpl->epoll_handle, EPOLL_CTL_MOD, static_cast<SOCKET>(fd), &ev) != 0)
 			{
-				throw exceptions::CanNotRemoveSocket(wsa_error_message("Failed to remove socket: "));
+				throw exceptions::CanNotModifySocket(wsa_error_message("Failed to modify socket: "));
 			}
-
-			status.erase(id);
 		}
-		catch (exceptions::CanNotRemoveSocket &)
+		catch (exceptions::CanNotModifySocket &)
 		{
 			throw;
 		}
 		catch (std::exception &e)
 		{
-			throw exceptions::CanNotRemoveSocket("Failed to remove socket: " + std::string(e.what()));
+			throw exceptions::CanNotModifySocket("Failed to modify socket: " + std::string(e.what()));
 		}
 		catch (...)
 		{
-			throw exceptions::CanNotRemoveSocket("Failed to remove socket: Unknown error");
+			throw exceptions::CanNotModifySocket("Failed to modify socket: Unknown error");
 		}
 	}
 
-	EventManager::~EventManager()
+	void EventManager::rearm_for_write(const int fd, void *token)
 	{
-		if (pimpl)
+		try
 		{
-			if (pimpl->epoll_handle)
-				epoll_close(pimpl->epoll_handle);
-		}
+			epoll_event ev{};
+			ev.events = EPOLLOUT | trigger_flags(trigger_mode::ONE_SHOT);
+			ev.data.ptr = token;
 
-		delete pimpl;
+			if (epoll_ctl(pimpl->epoll_handle, EPOLL_CTL_MOD, static_cast<SOCKET>(fd), &ev) != 0)
+			{
+				throw exceptions::CanNotModifySocket(wsa_error_message("Failed to modify socket: "));
+			}
+		}
+		catch (exceptions::CanNotModifySocket &)
+		{
+			throw;
+		}
+		catch (std::exception &e)
+		{
+			throw exceptions::CanNotModifySocket("Failed to modify socket: " + std::string(e.what()));
+		}
+		catch (...)
+		{
+			throw exceptions::CanNotModifySocket("Failed to modify socket: Unknown error");
+		}
 	}
 
-	std::vector<int> EventManager::wait_for_events()
+	void EventManager::remove_socket(const int fd)
 	{
 		try
 		{
-			std::vector<epoll_event> events(max_events);
-			int num_events = epoll_wait(pimpl->epoll_handle, events.data(), max_events, static_cast<int>(timeout));
-			if (num_events == -1)
-			{
-				throw exceptions::CanNotWaitForEvents(wsa_error_message("Failed to wait for events: "));
-			}
-
-			std::vector<int> fds;
-			fds.reserve(static_cast<size_t>(num_events));
-
-			for (int i = 0; i < num_events; ++i)
+			if (epoll_ctl(pimpl->epoll_handle, EPOLL_CTL_DEL, static_cast<SOCKET>(fd), nullptr) != 0)
 			{
-				int fd = events[i].data.fd;
-				if (events[i].events & EPOLLIN)
-				{
-					status[fd] |= socket_status::READABLE;
-				}
-				if (events[i].events & EPOLLOUT)
-				{
-					status[fd] |= socket_status::WRITABLE;
-				}
-				fds.push_back(fd);
+				throw exceptions::CanNotRemoveSocket(wsa_error_message("Failed to remove socket: "));
 			}
-
-			return fds;
 		}
-		catch (exceptions::CanNotWaitForEvents &)
+		catch (exceptions::CanNotRemoveSocket &)
 		{
 			throw;
 		}
 		catch (std::exception &e)
 		{
-			throw exceptions::CanNotWaitForEvents("Failed to wait for events: " + std::string(e.what()));
+			throw exceptions::CanNotRemoveSocket("Failed to remove socket: " + std::string(e.what()));
 		}
 		catch (...)
 		{
-			throw exceptions::CanNotWaitForEvents("Failed to wait for events: Unknown error");
+			throw exceptions::CanNotRemoveSocket("Failed to remove socket: Unknown error");
+		}
+	}
+
+	EventManager::~EventManager()
+	{
+		if (pimpl)
+		{
+			if (pimpl->epoll_handle)
+				epoll_close(pimpl->epoll_handle);
 		}
+
+		delete pimpl;
 	}
 
-	const bool EventManager::is_readable(const int id) const
+	int EventManager::wait_for_events()
 	{
-		return status.at(id) & socket_status::READABLE;
+		return wait_for_events(timeout);
 	}
 
-	const bool EventManager::is_writable(const int id) const
+	int EventManager::wait_for_events(const time_t wait_timeout)
 	{
-		return status.at(id) & socket_status::WRITABLE;
+		int num_events = epoll_wait(pimpl->epoll_handle, pimpl->events.data(), max_events, static_cast<int>(wait_timeout));
+		if (num_events == -1)
+		{
+			throw exceptions::CanNotWaitForEvents(wsa_error_message("Failed to wait for events: "));
+		}
+		return num_events;
 	}
 
-	void EventManager::clear_status(const int id)
+	SocketEvent EventManager::event(const int index) const noexcept
 	{
-		status[id] = socket_status::IDLE;
+		const epoll_event &ev = pimpl->events[index];
+		int status = socket_status::IDLE;
+		// Errors and hang-ups are reported as readiness so the owner's next I/O call surfaces them.
+		if (ev.events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+		{
+			status |= socket_status::READABLE;
+		}
+		if (ev.events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+		{
+			status |= socket_status::WRITABLE;
+		}
+		return SocketEvent{ev.data.ptr, status};
 	}
 }
 
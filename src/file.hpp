@@ -0,0 +1,88 @@
+#ifndef FILE_HPP
+#define FILE_HPP
+
+#include "tcp.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace http
+{
+    /// Metadata of a file system entry.
+    struct FileStatus
+    {
+        bool is_regular = false;
+        bool is_directory = false;
+        uint64_t size = 0;
+        /// Modification time in nanoseconds since the epoch.
+        int64_t modified = 0;
+        /// Identifies the file itself (inode / file index), a replaced file gets a new one.
+        uint64_t identity = 0;
+
+        bool same_file(const FileStatus &other) const noexcept
+        {
+            return identity == other.identity && size == other.size && modified == other.modified;
+        }
+    };
+
+    /// Read-only file opened for serving, closed when the last owner releases it.
+    class File
+    {
+    public:
+        /// How the file is going to be read, passed on to the OS read-ahead (posix_fadvise).
+        enum Access
+        {
+            /// Read once from start to end, e.g. by sendfile.
+            SEQUENTIAL,
+            /// The contents were copied elsewhere, the page cache may drop them.
+            DONT_NEED
+        };
+
+    private:
+        tcp::FileHandle file_handle;
+
+        explicit File(tcp::FileHandle file_handle) noexcept : file_handle(file_handle) {}
+
+    public:
+        ~File();
+
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+
+        /// @return The opened file, or nullptr if path does not exist or can not be read.
+        static std::shared_ptr<File> open(const std::string &path);
+
+        /// @brief Reads the metadata of a path without opening it.
+        /// @return False if the path does not exist.
+        static bool status(const std::string &path, FileStatus &status);
+
+        /// @brief Reads the metadata of the opened file.
+        /// @return False if it can not be read.
+        bool status(FileStatus &status) const;
+
+        /// @brief Reads up to length bytes at offset.
+        /// @return Bytes read, less than length only at the end of the file.
+        /// @throws std::runtime_error If reading fails.
+        size_t read_at(uint64_t offset, char *buffer, size_t length) const;
+
+        /// @brief Hints the OS how the given range is going to be read. Ignored where not supported.
+        void advise(Access access, uint64_t offset = 0, uint64_t length = 0) const noexcept;
+
+        tcp::FileHandle handle() const noexcept
+        {
+            return file_handle;
+        }
+    };
+
+    /// A byte range of an open file sent as a response body.
+    struct FileRegion
+    {
+        std::shared_ptr<const File> file;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+}
+
+#endif // FILE_HPP
@@ -0,0 +1,95 @@
+#ifdef __linux__
+
+#include "file.hpp"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    void fill_status(const struct stat &info, http::FileStatus &status)
+    {
+        status.is_regular = S_ISREG(info.st_mode);
+        status.is_directory = S_ISDIR(info.st_mode);
+        status.size = static_cast<uint64_t>(info.st_size);
+        status.modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+        status.identity = (static_cast<uint64_t>(info.st_dev) << 32) ^ static_cast<uint64_t>(info.st_ino);
+    }
+}
+
+http::File::~File()
+{
+    ::close(static_cast<int>(file_handle));
+}
+
+std::shared_ptr<http::File> http::File::open(const std::string &path)
+{
+    int fd;
+    do
+    {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    return std::shared_ptr<File>(new File(fd));
+}
+
+bool http::File::status(const std::string &path, FileStatus &status)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    fill_status(info, status);
+    return true;
+}
+
+bool http::File::status(FileStatus &status) const
+{
+    struct stat info;
+    if (::fstat(static_cast<int>(file_handle), &info) != 0)
+    {
+        return false;
+    }
+    fill_status(info, status);
+    return true;
+}
+
+size_t http::File::read_at(uint64_t offset, char *buffer, size_t length) const
+{
+    size_t total_read = 0;
+    while (total_read < length)
+    {
+        ssize_t bytes_read = ::pread(static_cast<int>(file_handle), buffer + total_read, length - total_read, static_cast<off_t>(offset + total_read));
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error(std::string("HTTP: Failed to read file: ") + strerror(errno));
+        }
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        total_read += static_cast<size_t>(bytes_read);
+    }
+    return total_read;
+}
+
+void http::File::advise(Access access, uint64_t offset, uint64_t length) const noexcept
+{
+    int advice = access == SEQUENTIAL ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_DONTNEED;
+    posix_fadvise(static_cast<int>(file_handle), static_cast<off_t>(offset), static_cast<off_t>(length), advice);
+}
+
+#endif // __linux__
@@ -0,0 +1,52 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <string>
+#include <vector>
+
+namespace http
+{
+    /// Reports changes to the entries of watched directories through a pollable handle (inotify).
+    /// Not supported on Windows, where handle() is -1 and nothing is ever reported.
+    class FileWatcher
+    {
+    public:
+        /// One change read from the handle.
+        struct Change
+        {
+            /// Watch the change belongs to, as returned by watch().
+            int watch = -1;
+            /// Name of the changed entry within the watched directory, empty if the directory itself changed.
+            std::string name;
+            /// True if the directory itself was removed or moved; its watch is gone.
+            bool watch_removed = false;
+            /// True if changes were lost because too many were queued; everything has to be assumed changed.
+            bool overflow = false;
+        };
+
+    private:
+        int watch_handle;
+
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher &) = delete;
+        FileWatcher &operator=(const FileWatcher &) = delete;
+
+        /// @return Handle that becomes readable when changes are queued, -1 if watching is not supported.
+        int handle() const noexcept
+        {
+            return watch_handle;
+        }
+
+        /// @brief Starts reporting the creation, removal, renaming, modification and attribute changes of the directory's entries.
+        /// @return Watch id, or -1 if the directory can not be watched.
+        int watch(const std::string &directory);
+
+        /// @brief Reads every change queued so far without blocking and appends it to changes.
+        void read_changes(std::vector<Change> &changes);
+    };
+}
+
+#endif // FILE_WATCHER_HPP
@@ -0,0 +1,85 @@
+#ifdef __linux__
+
+#include "file_watcher.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+    const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+    // Room for many events per read; one event is at most sizeof(inotify_event) + NAME_MAX + 1 bytes.
+    const size_t READ_BUFFER_SIZE = 64 * 1024;
+}
+
+http::FileWatcher::FileWatcher() : watch_handle(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+http::FileWatcher::~FileWatcher()
+{
+    if (watch_handle >= 0)
+    {
+        ::close(watch_handle);
+    }
+}
+
+int http::FileWatcher::watch(const std::string &directory)
+{
+    if (watch_handle < 0)
+    {
+        return -1;
+    }
+    return inotify_add_watch(watch_handle, directory.c_str(), WATCH_MASK);
+}
+
+void http::FileWatcher::read_changes(std::vector<Change> &changes)
+{
+    if (watch_handle < 0)
+    {
+        return;
+    }
+    alignas(struct inotify_event) char buffer[READ_BUFFER_SIZE];
+    while (true)
+    {
+        ssize_t bytes_read = ::read(watch_handle, buffer, sizeof(buffer));
+        if (bytes_read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_read <= 0)
+        {
+            return; // EAGAIN once the queue is drained.
+        }
+        for (char *position = buffer; position < buffer + bytes_read;)
+        {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(position);
+            position += sizeof(struct inotify_event) + event->len;
+
+            Change change;
+            change.watch = event->wd;
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                change.overflow = true;
+            }
+            else if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                // A moved directory keeps its watch, it is removed here so it does not report under its old name.
+                if (event->mask & IN_MOVE_SELF)
+                {
+                    inotify_rm_watch(watch_handle, event->wd);
+                }
+                change.watch_removed = true;
+            }
+            else if (event->len > 0)
+            {
+                change.name = event->name;
+            }
+            changes.push_back(std::move(change));
+        }
+    }
+}
+
+#endif // __linux__
@@ -0,0 +1,21 @@
+#ifdef _WIN32
+
+#include "file_watcher.hpp"
+
+// ReadDirectoryChangesW can not be polled by the socket-only event manager, so nothing is watched
+// and the cached file status is revalidated by age instead.
+
+http::FileWatcher::FileWatcher() : watch_handle(-1) {}
+
+http::FileWatcher::~FileWatcher() {}
+
+int http::FileWatcher::watch(const std::string &)
+{
+    return -1;
+}
+
+void http::FileWatcher::read_changes(std::vector<Change> &)
+{
+}
+
+#endif // _WIN32
@@ -0,0 +1,115 @@
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "file.hpp"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // FILETIME counts 100 ns intervals since 1601-01-01.
+    const int64_t FILETIME_UNIX_EPOCH = 116444736000000000LL;
+
+    int64_t to_unix_nanoseconds(const FILETIME &time)
+    {
+        int64_t ticks = (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        return (ticks - FILETIME_UNIX_EPOCH) * 100;
+    }
+
+    std::wstring widen(const std::string &path)
+    {
+        int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        if (length <= 0)
+        {
+            return std::wstring();
+        }
+        std::wstring wide(static_cast<size_t>(length), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], length);
+        wide.resize(static_cast<size_t>(length - 1));
+        return wide;
+    }
+}
+
+http::File::~File()
+{
+    CloseHandle(reinterpret_cast<HANDLE>(file_handle));
+}
+
+std::shared_ptr<http::File> http::File::open(const std::string &path)
+{
+    // FILE_SHARE_DELETE lets files be replaced while they are being served, as on POSIX.
+    HANDLE handle = CreateFileW(widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+    return std::shared_ptr<File>(new File(reinterpret_cast<tcp::FileHandle>(handle)));
+}
+
+bool http::File::status(const std::string &path, FileStatus &status)
+{
+    // FILE_FLAG_BACKUP_SEMANTICS is needed to open directories.
+    HANDLE handle = CreateFileW(widen(path).c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    File file(reinterpret_cast<tcp::FileHandle>(handle));
+    return file.status(status);
+}
+
+bool http::File::status(FileStatus &status) const
+{
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(reinterpret_cast<HANDLE>(file_handle), &info))
+    {
+        return false;
+    }
+    status.is_directory = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    status.is_regular = !status.is_directory;
+    status.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    status.modified = to_unix_nanoseconds(info.ftLastWriteTime);
+    status.identity = ((static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow) ^ (static_cast<uint64_t>(info.dwVolumeSerialNumber) << 48);
+    return true;
+}
+
+size_t http::File::read_at(uint64_t offset, char *buffer, size_t length) const
+{
+    size_t total_read = 0;
+    while (total_read < length)
+    {
+        uint64_t position = offset + total_read;
+        OVERLAPPED location = {};
+        location.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+        location.OffsetHigh = static_cast<DWORD>(position >> 32);
+        DWORD bytes_read = 0;
+        DWORD to_read = static_cast<DWORD>(std::min<size_t>(length - total_read, 1u << 30));
+        if (!ReadFile(reinterpret_cast<HANDLE>(file_handle), buffer + total_read, to_read, &bytes_read, &location))
+        {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+            {
+                break;
+            }
+            throw std::runtime_error("HTTP: Failed to read file");
+        }
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        total_read += bytes_read;
+    }
+    return total_read;
+}
+
+void http::File::advise(Access, uint64_t, uint64_t) const noexcept
+{
+    // Read-ahead is requested with FILE_FLAG_SEQUENTIAL_SCAN when opening, there is no per-range hint.
+}
+
+#endif // _WIN32
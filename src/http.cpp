@@ -10,8 +10,8 @@
 #include "event_manager.hpp"
 #include "logger.hpp"
 
-#include <map>
 #include <cstring>
+#include <algorithm>
 
 bool Logger::logger_running = false;
 
@@ -54,13 +54,16 @@ http::HttpServer::HttpServer(HttpServerConfig _config, const std::function<void(
 
     try
     {
-        pimpl = new Impl(std::move(tcp::ListeningSocket(_config.port, _config.max_pending_connections)), std::move(tcp::EventManager(_config.max_concurrent_connections + 1, 1000)), std::move(tcp::EventManager(_config.max_concurrent_connections + 1, 100)), _config, handler);
+        pimpl = new Impl(std::move(tcp::ListeningSocket(_config.port, _config.max_pending_connections)), std::move(tcp::EventManager(_config.max_concurrent_connections + _config.reserved_connections + 1, 1000)), std::move(tcp::EventManager(_config.max_concurrent_connections + _config.reserved_connections + 1, 100)), _config, handler);
         pimpl->log_info("Server created on port:" + std::to_string(_config.port));
 
         size_t handler_thread_count = std::max(std::thread::hardware_concurrency() * 2, 8U);
         pimpl->handler_threads.resize(handler_thread_count);
         pimpl->initialize_handler_threads();
 
+        pimpl->body_producer_threads.resize(_config.body_producer_threads);
+        pimpl->initialize_body_producer_threads();
+
         pimpl->initialize_response_thread();
     }
     catch (const tcp::exceptions::CanNotCreateSocket &e)
@@ -119,82 +122,95 @@ void http::HttpServer::start()
     pimpl->start_event_loop();
 }
 
+http::BufferPoolStats http::HttpServer::buffer_pool_stats() const
+{
+    return pimpl->buffer_pool.stats();
+}
+
+void http::HttpServer::watch_static_files(const StaticFiles &files)
+{
+    if (pimpl->started)
+    {
+        throw std::logic_error("HTTP: Static files can only be watched before the server starts");
+    }
+    int handle = StaticFilesWatch::enable(files);
+    if (handle < 0)
+    {
+        pimpl->log_warning("File change notifications are not available, static files are revalidated by age.");
+        return;
+    }
+    // Kept only once its handle is polled, otherwise the cache would wait for changes nothing applies.
+    std::unique_ptr<StaticFiles> watched(new StaticFiles(files));
+    try
+    {
+        pimpl->watched_static_files.reserve(pimpl->watched_static_files.size() + 1);
+        pimpl->request_event_manager.register_for_read(handle, watched.get(), tcp::trigger_mode::LEVEL_TRIGGERED);
+    }
+    catch (...)
+    {
+        StaticFilesWatch::disable(files);
+        throw;
+    }
+    pimpl->watched_static_files.push_back(std::move(watched));
+}
+
 void http::HttpServer::Impl::start_event_loop()
 {
+    started = true;
     try
     {
         log_info("Server listening on port: " + std::to_string(config.port));
-        int server_id = request_event_manager.register_for_read(server_socket.fd());
+        accepted_sockets.reserve(std::max(config.max_accepts_per_iteration, 1U));
+        // Level-triggered so peers left in the backlog by the accept budget are reported again.
+        request_event_manager.register_for_read(server_socket.fd(), &server_socket, tcp::trigger_mode::LEVEL_TRIGGERED);
         while (true)
         {
             try
             {
-                std::vector<int> active_connections = request_event_manager.wait_for_events();
+                // Connections with input left over from their last quantum must not wait for the poll timeout.
+                int event_count = pending_input_connections.empty() ? request_event_manager.wait_for_events() : request_event_manager.wait_for_events(0);
+                // The wait times out every second, so the date is never much older than that.
+                header_cache.refresh(time(nullptr));
 
-                if (request_event_manager.is_readable(server_id))
-                {
-                    accept_new_connections();
-                    request_event_manager.clear_status(server_id);
-                }
+                serving_input_connections.swap(pending_input_connections);
 
-                for (auto conn_id : active_connections)
+                for (int i = 0; i < event_count; ++i)
                 {
-                    if (conn_id == server_id)
-                        continue;
-                    HttpConnection &connection = connections.at(conn_id);
-                    if (request_event_manager.is_readable(conn_id))
+                    tcp::SocketEvent event = request_event_manager.event(i);
+                    if (event.token == &server_socket)
                     {
-                        connection.set_peer_writing();
-                    }
-                }
-
-                for (auto conn_id : active_connections)
-                {
-                    if (conn_id == server_id)
+                        if (accepting_connections && event.is_readable())
+                        {
+                            accept_new_connections();
+                        }
                         continue;
-
-                    request_event_manager.clear_status(conn_id);
-
-                    HttpConnection &connection = connections.at(conn_id);
-
-                    if (connection.peer_is_readable() && connection.get_current_request().get_status() < RequestStatus::HEADERS_DONE)
+                    }
+                    if (!watched_static_files.empty() && apply_file_changes(event.token))
                     {
-                        connection.read_and_build_request_head();
-                        connection.set_peer_idle();
+                        continue;
                     }
 
-                    if (connection.get_current_request().get_status() == HEADERS_DONE)
+                    HttpConnection &connection = *static_cast<HttpConnection *>(event.token);
+                    if (event.is_readable())
                     {
-                        request_event_manager.remove_socket(conn_id);
-                        {
-                            std::lock_guard<std::mutex> lock(handler_mutex);
-                            waiting_for_handler_connections.push(&connection);
-                        }
-                        handler_cv.notify_one();
+                        connection.set_peer_writing();
                     }
+                    process_connection_input(connection);
+                }
 
-                    if (connection.get_current_request().get_status() == RequestStatus::CLIENT_ERROR || connection.get_current_request().get_status() == RequestStatus::SERVER_ERROR)
+                // Second turn for connections left over from the previous iteration, unless an event already finished their head.
+                for (HttpConnection *connection : serving_input_connections)
+                {
+                    if (connection->get_current_request().get_status() < RequestStatus::HEADERS_DONE)
                     {
-                        request_event_manager.remove_socket(conn_id);
-                        if (connection.inactive)
-                        {
-                            {
-                                std::lock_guard<std::mutex> lock(completed_connections_mutex);
-                                completed_connections.push(&connection);
-                            }
-                        }
-                        else
-                        {
-                            {
-                                std::lock_guard<std::mutex> lock(response_mutex);
-                                waiting_to_send_response.push(&connection);
-                            }
-                            response_cv.notify_one();
-                        }
+                        connection->set_peer_writing();
+                        process_connection_input(*connection);
                     }
                 }
+                serving_input_connections.clear();
                 mark_inactive_connections();
                 remove_completed_connections();
+                resume_accepting();
             }
             catch (const std::exception &e)
             {
@@ -218,31 +234,93 @@ void http::HttpServer::Impl::start_event_loop()
     }
 }
 
-void http::HttpServer::Impl::mark_inactive_connections()
+void http::HttpServer::Impl::process_connection_input(HttpConnection &connection)
 {
-    static time_t last_timeout_check = 0;
-    if (time(nullptr) - last_timeout_check >= 1)
+    if (connection.peer_is_readable() && connection.get_current_request().get_status() < RequestStatus::HEADERS_DONE)
     {
-        last_timeout_check = time(nullptr);
-        for (auto &it : connections)
+        connection.read_and_build_request_head(config.io_quantum_bytes);
+        connection.set_peer_idle();
+        if (connection.get_current_request().get_status() < RequestStatus::HEADERS_DONE)
         {
-            auto &conn = it.second;
-            if (!conn.inactive && conn.idle_time() > config.inactive_connection_timeout_in_seconds)
+            if (connection.has_pending_input())
             {
-                log_info("Connection timed out: " + conn.get_ip() + ":" + std::to_string(conn.get_port()));
-                conn.inactive = true;
-
-                if (conn.get_current_request().get_status() < RequestStatus::REQUEST_HANDLING_DONE)
-                {
-                    request_event_manager.remove_socket(it.first);
-                    {
-                        std::lock_guard<std::mutex> lock(completed_connections_mutex);
-                        completed_connections.push(&conn);
-                    }
-                }
+                // The socket is not re-armed and would not report these bytes again.
+                pending_input_connections.push_back(&connection);
+            }
+            else
+            {
+                request_event_manager.rearm_for_read(connection.fd(), &connection);
             }
         }
     }
+
+    if (connection.get_current_request().get_status() == HEADERS_DONE)
+    {
+        if (response_cache && connection.respond_from_cache(*response_cache))
+        {
+            // Hits are sent from the event loop, the handler threads never see them.
+            send_response_or_arm(connection);
+            return;
+        }
+        if (request_coalescer && connection.join_flight(*request_coalescer, response_sharing))
+        {
+            // Holds no thread while parked, finish_flight picks it up with the leader's response.
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(handler_mutex);
+            waiting_for_handler_connections.push(&connection);
+        }
+        handler_cv.notify_one();
+    }
+
+    if (connection.get_current_request().get_status() == RequestStatus::CLIENT_ERROR || connection.get_current_request().get_status() == RequestStatus::SERVER_ERROR)
+    {
+        if (connection.inactive)
+        {
+            queue_completed(connection);
+        }
+        else
+        {
+            send_response_or_arm(connection);
+        }
+    }
+}
+
+bool http::HttpServer::Impl::apply_file_changes(void *token)
+{
+    for (const std::unique_ptr<StaticFiles> &files : watched_static_files)
+    {
+        if (files.get() == token)
+        {
+            StaticFilesWatch::apply_changes(*files);
+            return true;
+        }
+    }
+    return false;
+}
+
+void http::HttpServer::Impl::mark_inactive_connections()
+{
+    static time_t last_timeout_check = 0;
+    if (time(nullptr) - last_timeout_check >= 1)
+    {
+        last_timeout_check = time(nullptr);
+        connections.for_each([this](HttpConnection &conn)
+                             {
+                                 if (!conn.inactive && conn.idle_time() > config.inactive_connection_timeout_in_seconds)
+                                 {
+                                     log_info("Connection timed out: " + conn.get_ip() + ":" + std::to_string(conn.get_port()));
+                                     conn.inactive = true;
+
+                                     // Only a connection reading its head belongs to the event loop. Later on the handler thread, flight or
+                                     // response thread working on it queues it once it sees the flag, its slot must not be reused before.
+                                     if (conn.get_current_request().get_status() < RequestStatus::HEADERS_DONE)
+                                     {
+                                         queue_completed(conn);
+                                     }
+                                 } });
+    }
 }
 
 void http::HttpServer::Impl::remove_completed_connections()
@@ -250,32 +328,99 @@ void http::HttpServer::Impl::remove_completed_connections()
     std::lock_guard<std::mutex> lock(completed_connections_mutex);
     while (!completed_connections.empty())
     {
-        HttpConnection *completed_connection = completed_connections.front();
+        ConnectionHandle completed_connection = completed_connections.front();
         completed_connections.pop();
 
-        auto id_it = connection_ids.find(completed_connection);
-        if (id_it == connection_ids.end())
+        // A stale handle means the connection was queued more than once and is already closed.
+        if (!connections.release(completed_connection))
         {
             continue;
         }
-
-        int conn_id = id_it->second;
-        connection_ids.erase(id_it);
-        connections.erase(conn_id);
+        pending_input_connections.erase(std::remove(pending_input_connections.begin(), pending_input_connections.end(), completed_connection.connection), pending_input_connections.end());
     }
 }
 
 void http::HttpServer::Impl::accept_new_connections()
 {
-    std::vector<tcp::ConnectionSocket> new_connections = server_socket.accept_connections();
-    for (auto &conn : new_connections)
+    if (connections.size() >= connection_limit())
+    {
+        pause_accepting();
+        return;
+    }
+
+    size_t budget = std::min(static_cast<size_t>(std::max(config.max_accepts_per_iteration, 1U)), connection_limit() - connections.size());
+    server_socket.accept_connections(accepted_sockets, budget);
+    for (auto &conn : accepted_sockets)
+    {
+        if (connections.size() >= config.max_concurrent_connections && !is_reserved_source(conn.get_ip()))
+        {
+            // Only reserved slots are left, the socket is closed when accepted_sockets is cleared.
+            log_warning("Connection rejected, connection limit reached: " + conn.get_ip() + ":" + std::to_string(conn.get_port()));
+            continue;
+        }
+
+        HttpConnection *connection = connections.acquire(std::move(conn));
+        try
+        {
+            // One-shot: after a reported read the socket stays silent until re-armed, so handing the
+            // connection to a handler thread needs no deregistration.
+            request_event_manager.register_for_read(connection->fd(), connection, tcp::trigger_mode::ONE_SHOT);
+        }
+        catch (...)
+        {
+            connections.release(connections.handle(*connection));
+            throw;
+        }
+        if (Logger::logger_running)
+        {
+            log_info("Connection accepted: " + connection->get_ip() + ":" + std::to_string(connection->get_port()));
+        }
+    }
+    accepted_sockets.clear();
+
+    if (connections.size() >= connection_limit())
+    {
+        pause_accepting();
+    }
+}
+
+void http::HttpServer::Impl::pause_accepting()
+{
+    if (!accepting_connections)
     {
-        int conn_id = request_event_manager.register_for_read(conn.fd());
-        auto insert_result = connections.emplace(conn_id, http::HttpConnection(std::move(conn)));
-        HttpConnection *connection = &insert_result.first->second;
-        connection_ids[connection] = conn_id;
-        log_info("Connection accepted: " + connection->get_ip() + ":" + std::to_string(connection->get_port()));
+        return;
     }
+    request_event_manager.remove_socket(server_socket.fd());
+    accepting_connections = false;
+    log_warning("Connection limit reached, pausing accept.");
+}
+
+void http::HttpServer::Impl::resume_accepting()
+{
+    if (accepting_connections || connections.size() >= connection_limit())
+    {
+        return;
+    }
+    request_event_manager.register_for_read(server_socket.fd(), &server_socket, tcp::trigger_mode::LEVEL_TRIGGERED);
+    accepting_connections = true;
+    log_info("Connection slots available, resuming accept.");
+}
+
+size_t http::HttpServer::Impl::connection_limit() const noexcept
+{
+    return static_cast<size_t>(config.max_concurrent_connections) + config.reserved_connections;
+}
+
+bool http::HttpServer::Impl::is_reserved_source(const std::string &ip) const
+{
+    for (const auto &source : config.reserved_connection_sources)
+    {
+        if (source == ip)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 void http::HttpServer::Impl::initialize_handler_threads()
@@ -304,35 +449,36 @@ void http::HttpServer::Impl::initialize_handler_threads()
                     }
 
                     connection->handle_request(request_handler, config.max_request_body_size);
-                    if (connection->inactive)
+                    if (response_cache)
                     {
-                        {
-                            std::lock_guard<std::mutex> lock(completed_connections_mutex);
-                            completed_connections.push(connection);
-                        }
-                        continue;
+                        connection->store_in_cache(*response_cache);
+                    }
+                    if (request_coalescer)
+                    {
+                        finish_flight(*connection);
                     }
+                    if (connection->inactive)
                     {
-                        std::lock_guard<std::mutex> lock(response_mutex);
-                        waiting_to_send_response.push(connection);
+                        queue_completed(*connection);
+                        continue;
                     }
-                    response_cv.notify_one();
+                    start_body_producer(*connection);
+                    // The socket is almost always writable here; the response thread only takes over when it fills up.
+                    send_response_or_arm(*connection);
                 }
                 catch (const std::exception &e)
                 {
                     (void)e;
                     if (connection)
                     {
-                        std::lock_guard<std::mutex> lock(completed_connections_mutex);
-                        completed_connections.push(connection);
+                        queue_completed(*connection);
                     }
                 }
                 catch (...)
                 {
                     if (connection)
                     {
-                        std::lock_guard<std::mutex> lock(completed_connections_mutex);
-                        completed_connections.push(connection);
+                        queue_completed(*connection);
                     }
                 }
             }
@@ -358,83 +504,231 @@ void http::HttpServer::Impl::initialize_response_thread()
             {
                 std::unique_lock<std::mutex> lock(response_mutex);
                 response_cv.wait(lock, [this]()
-                                 { return !waiting_to_send_response.empty() || !response_sending_connections.empty(); });
+                                 { return response_sending_count != 0; });
+            }
 
-                while (!waiting_to_send_response.empty())
+            try
+            {
+                int event_count = response_event_manager.wait_for_events();
+                for (int i = 0; i < event_count; ++i)
                 {
-                    HttpConnection *connection = waiting_to_send_response.front();
-                    waiting_to_send_response.pop();
+                    send_response_or_arm(*static_cast<HttpConnection *>(response_event_manager.event(i).token));
+                }
+            }
+            catch (const std::exception &e)
+            {
+                log_error(std::string("Error in response thread: ") + e.what());
+            }
+            catch (...)
+            {
+                log_error("Unknown error in response thread.");
+            }
+        }
+    };
 
-                    if (!connection)
-                    {
-                        continue;
-                    }
+    response_thread = std::thread(response_thread_function);
+}
 
-                    int id = response_event_manager.register_for_write(connection->fd());
-                    response_sending_connections[id] = connection;
-                }
+bool http::HttpServer::Impl::send_response_or_arm(HttpConnection &connection)
+{
+    try
+    {
+        connection.send_response(config.io_quantum_bytes);
+    }
+    catch (const std::exception &e)
+    {
+        log_error(std::string("Error sending response: ") + e.what());
+        connection.inactive = true;
+    }
+    catch (...)
+    {
+        log_error("Unknown error sending response.");
+        connection.inactive = true;
+    }
+
+    if (connection.get_current_request().get_status() != RequestStatus::COMPLETED && !connection.inactive)
+    {
+        // A parked response is armed again by its body producer once bytes are buffered.
+        if (connection.waiting_for_body() && connection.park_until_body_available())
+        {
+            return false;
+        }
+        if (arm_for_write(connection))
+        {
+            return false;
+        }
+    }
+
+    finish_response(connection);
+    return true;
+}
+
+bool http::HttpServer::Impl::arm_for_write(HttpConnection &connection)
+{
+    try
+    {
+        if (connection.write_registered)
+        {
+            response_event_manager.rearm_for_write(connection.fd(), &connection);
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lock(response_mutex);
+                ++response_sending_count;
             }
+            connection.write_registered = true;
+            response_event_manager.register_for_write(connection.fd(), &connection, tcp::trigger_mode::ONE_SHOT);
+            response_cv.notify_one();
+        }
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        log_error(std::string("Error waiting for socket to become writable: ") + e.what());
+        connection.inactive = true;
+    }
+    return false;
+}
+
+void http::HttpServer::Impl::finish_response(HttpConnection &connection)
+{
+    if (connection.write_registered)
+    {
+        std::lock_guard<std::mutex> lock(response_mutex);
+        --response_sending_count;
+    }
+    // Closing the socket drops its registration, no epoll call is needed here.
+    queue_completed(connection);
+}
 
-            if (response_sending_connections.empty())
+void http::HttpServer::Impl::finish_flight(HttpConnection &leader)
+{
+    if (leader.flight_key().empty())
+    {
+        return;
+    }
+    std::vector<HttpConnection *> followers = request_coalescer->finish(leader.flight_key());
+    if (followers.empty())
+    {
+        return;
+    }
+
+    HttpResponseSnapshot snapshot = leader.share_response(response_sharing);
+    if (!snapshot)
+    {
+        {
+            std::lock_guard<std::mutex> lock(handler_mutex);
+            for (HttpConnection *follower : followers)
             {
-                continue;
+                follower->leave_flight();
+                waiting_for_handler_connections.push(follower);
             }
+        }
+        handler_cv.notify_all();
+        return;
+    }
 
-            try
+    for (HttpConnection *follower : followers)
+    {
+        follower->respond_with(snapshot);
+        if (follower->inactive)
+        {
+            queue_completed(*follower);
+        }
+        else
+        {
+            send_response_or_arm(*follower);
+        }
+    }
+}
+
+void http::HttpServer::Impl::queue_completed(HttpConnection &connection)
+{
+    std::lock_guard<std::mutex> lock(completed_connections_mutex);
+    completed_connections.push(connections.handle(connection));
+}
+
+void http::HttpServer::Impl::start_body_producer(HttpConnection &connection)
+{
+    if (body_producer_threads.empty() || connection.get_current_request().get_status() != RequestStatus::REQUEST_HANDLING_DONE)
+    {
+        return;
+    }
+
+    std::shared_ptr<BodyProducer> producer = connection.make_body_producer(config.body_producer_high_watermark, config.body_producer_low_watermark);
+    if (!producer)
+    {
+        return;
+    }
+
+    // The response owns the producer; the weak reference lets a paused producer die with it.
+    std::weak_ptr<BodyProducer> weak_producer = producer;
+    HttpConnection *resumed_connection = &connection;
+    producer->set_wakeups(
+        [this, resumed_connection]()
+        {
+            if (!arm_for_write(*resumed_connection))
             {
-                std::vector<int> active_connections = response_event_manager.wait_for_events();
-                for (auto id : active_connections)
-                {
-                    auto response_it = response_sending_connections.find(id);
-                    if (response_it == response_sending_connections.end())
-                    {
-                        continue;
-                    }
+                finish_response(*resumed_connection);
+            }
+        },
+        [this, weak_producer]()
+        {
+            if (auto paused_producer = weak_producer.lock())
+            {
+                schedule_body_producer(std::move(paused_producer));
+            }
+        });
+    schedule_body_producer(std::move(producer));
+}
 
-                    HttpConnection *connection = response_it->second;
-                    if (!connection)
-                    {
-                        response_event_manager.remove_socket(id);
-                        response_sending_connections.erase(response_it);
-                        continue;
-                    }
+void http::HttpServer::Impl::schedule_body_producer(std::shared_ptr<BodyProducer> producer)
+{
+    {
+        std::lock_guard<std::mutex> lock(body_producer_mutex);
+        waiting_body_producers.push(std::move(producer));
+    }
+    body_producer_cv.notify_one();
+}
 
-                    try
-                    {
-                        connection->send_response();
-                    }
-                    catch (const std::exception &e)
-                    {
-                        log_error(std::string("Error sending response: ") + e.what());
-                        connection->inactive = true;
-                    }
-                    catch (...)
-                    {
-                        log_error("Unknown error sending response.");
-                        connection->inactive = true;
-                    }
+void http::HttpServer::Impl::initialize_body_producer_threads()
+{
+    auto body_producer_thread_function = [this]()
+    {
+        while (true)
+        {
+            std::shared_ptr<BodyProducer> producer;
+            {
+                std::unique_lock<std::mutex> lock(body_producer_mutex);
+                body_producer_cv.wait(lock, [this]()
+                                      { return !waiting_body_producers.empty(); });
+                producer = std::move(waiting_body_producers.front());
+                waiting_body_producers.pop();
+            }
 
-                    if (connection->get_current_request().get_status() == RequestStatus::COMPLETED || connection->inactive)
-                    {
-                        response_event_manager.remove_socket(id);
-                        response_sending_connections.erase(response_it);
-                        {
-                            std::lock_guard<std::mutex> lock(completed_connections_mutex);
-                            completed_connections.push(connection);
-                        }
-                    }
+            try
+            {
+                // A full response buffer requeues the producer once drained, a used up quantum requeues it right away
+                // so that other generators get a turn.
+                if (producer->produce(config.io_quantum_bytes))
+                {
+                    schedule_body_producer(std::move(producer));
                 }
             }
             catch (const std::exception &e)
             {
-                log_error(std::string("Error in response thread: ") + e.what());
+                log_error(std::string("Error producing response body: ") + e.what());
             }
             catch (...)
             {
-                log_error("Unknown error in response thread.");
+                log_error("Unknown error producing response body.");
             }
         }
     };
 
-    response_thread = std::thread(response_thread_function);
-}
\ No newline at end of file
+    for (size_t i = 0; i < body_producer_threads.size(); ++i)
+    {
+        body_producer_threads[i] = std::thread(body_producer_thread_function);
+    }
+}
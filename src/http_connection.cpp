@@ -6,14 +6,83 @@
 #include "http_response_builder.hpp"
 #include "http_response_reader.hpp"
 #include "data_stream.hpp"
+#include "response_compression.hpp"
+#include "request_body_decoder.hpp"
+#include "file.hpp"
+#include "byte_ranges.hpp"
 
 #include <cstring>
 #include <vector>
 #include <cstdint>
+#include <algorithm>
 
 http::HttpConnection::CurrentRequest::CurrentRequest() : request(std::move(HttpRequestBuilder::build())), status(RequestStatus::CONNECTION_ESTABLISHED) {}
 
-http::HttpConnection::HttpConnection(tcp::ConnectionSocket &&socket) : client_socket(std::move(socket)), current_request(), current_response(HttpResponseBuilder::build()), last_activity_time(time(nullptr)) {}
+http::HttpConnection::HttpConnection(tcp::ConnectionSocket &&socket, BufferPool &buffer_pool, const HttpServerConfig &config, const ResponseHeaderCache &header_cache) : buffer_pool(&buffer_pool), config(&config), header_cache(&header_cache), client_socket(std::move(socket)), current_request(), current_response(HttpResponseBuilder::build()), last_activity_time(time(nullptr)) {}
+
+void http::HttpConnection::CurrentRequest::reset()
+{
+    HttpRequestBuilder::reset(request);
+    status = RequestStatus::CONNECTION_ESTABLISHED;
+    request_line_bytes_read = 0;
+    header_bytes_read = 0;
+    last_header_end = 0;
+    chunked_decoder.reset(0);
+    rejected_body_status = 0;
+    flight_key.clear();
+    has_chunked_body = false;
+    content_length = -1;
+    remaining_content_length = -1;
+    total_body_bytes_read = 0;
+    body_stream_cursor = 0;
+    body_end_cursor = 0;
+}
+
+void http::HttpConnection::CurrentResponse::reset()
+{
+    HttpResponseBuilder::reset(response);
+    has_chunked_body = false;
+    content_length = -1;
+    remaining_content_length = -1;
+    snapshot_cursor = 0;
+    file_part = 0;
+    file_cursor = 0;
+    file_prefix_written = false;
+    cache_entry.reset();
+    codec.reset();
+    compression_input_cursor = 0;
+    compression_input_size = 0;
+    uncompressed_remaining = -1;
+    uncompressed_done = false;
+    compression_finished = false;
+}
+
+void http::HttpConnection::open(tcp::ConnectionSocket &&socket)
+{
+    client_socket = std::move(socket);
+    last_activity_time = time(nullptr);
+}
+
+void http::HttpConnection::close()
+{
+    client_socket = tcp::ConnectionSocket(tcp::constants::INVALID_HANDLE, 0, 0);
+    // Dropping the response body here also stops a body producer still running for it.
+    current_request.reset();
+    release_compression();
+    current_response.reset();
+    buffer_start = 0;
+    buffer_cursor = 0;
+    buffer_size = 0;
+    parser_cursor = 0;
+    peer_status = ConnectionStatus::IDLE;
+    input_pending = false;
+    body_starved = false;
+    buffer_filled = false;
+    send_window = 0;
+    release_buffer();
+    inactive = false;
+    write_registered = false;
+}
 
 void http::HttpConnection::handle_request(std::function<void(const http::HttpRequest &, http::HttpResponse &)> &request_handler, size_t max_request_body_size) noexcept
 {
@@ -24,6 +93,7 @@ void http::HttpConnection::handle_request(std::function<void(const http::HttpReq
         current_request.content_length = content_length;
         current_request.remaining_content_length = content_length;
         current_request.has_chunked_body = has_chunked_body;
+        current_request.chunked_decoder.reset(config->max_header_size);
         current_request.total_body_bytes_read = 0;
 
         reposition_buffer();
@@ -56,23 +126,30 @@ void http::HttpConnection::handle_request(std::function<void(const http::HttpReq
         body_stream.set_stream_updater(
             [this, max_request_body_size]()
             {
-                if (buffer_cursor == buffer_size)
+                read_body(max_request_body_size);
+                if (current_request.body_stream_cursor == current_request.body_end_cursor && current_request.status == RequestStatus::READING_BODY)
                 {
-                    buffer_cursor = 0;
-                    buffer_size = 0;
+                    // Everything buffered was handed out or is partial chunk framing, drop the consumed bytes and wait for more.
+                    reposition_buffer();
+                    if (buffer_filled)
+                    {
+                        // The last read filled the buffer, the client sends faster than one buffer per read.
+                        grow_buffer(std::min(buffer.size() * 2, config->io_buffer_max_size));
+                    }
                     read_from_client();
+                    read_body(max_request_body_size);
                 }
-                read_body(max_request_body_size);
             });
 
         body_stream.set_stream_view_provider(
             [this]() -> DataStream::StreamView
             {
                 DataStream::StreamView view;
-                view.data = buffer.data();
+                view.data = window().data();
                 view.size = current_request.body_end_cursor;
                 view.cursor = current_request.body_stream_cursor;
-                view.is_closed = current_request.status == RequestStatus::REQUEST_READING_DONE;
+                // The last span may still be unread when the whole body has arrived.
+                view.is_closed = current_request.status == RequestStatus::REQUEST_READING_DONE && current_request.body_stream_cursor == current_request.body_end_cursor;
                 view.error = current_request.status == RequestStatus::CLIENT_ERROR || current_request.status == RequestStatus::SERVER_ERROR || inactive;
                 return view;
             });
@@ -89,6 +166,11 @@ void http::HttpConnection::handle_request(std::function<void(const http::HttpReq
                 }
             });
 
+        if (config->request_decompression && current_request.status == RequestStatus::READING_BODY)
+        {
+            body_stream = decode_body_stream(std::move(body_stream), max_request_body_size);
+        }
+
         HttpRequestBuilder::set_body_stream(current_request.request, std::move(body_stream));
 
         try
@@ -105,8 +187,21 @@ void http::HttpConnection::handle_request(std::function<void(const http::HttpReq
         catch (const std::exception &e)
         {
             log_error(std::string("Error handling request: ") + e.what());
-            current_request.status = RequestStatus::SERVER_ERROR;
-            current_response.response = http::HttpResponseBuilder::build(http::status_codes::INTERNAL_SERVER_ERROR, "Internal Server Error");
+            if (current_request.rejected_body_status == http::status_codes::PAYLOAD_TOO_LARGE)
+            {
+                current_request.status = RequestStatus::CLIENT_ERROR;
+                current_response.response = http::HttpResponseBuilder::build(http::status_codes::PAYLOAD_TOO_LARGE, "Payload Too Large");
+            }
+            else if (current_request.rejected_body_status != 0)
+            {
+                current_request.status = RequestStatus::CLIENT_ERROR;
+                current_response.response = http::HttpResponseBuilder::build(http::status_codes::BAD_REQUEST, "Bad Request");
+            }
+            else
+            {
+                current_request.status = RequestStatus::SERVER_ERROR;
+                current_response.response = http::HttpResponseBuilder::build(http::status_codes::INTERNAL_SERVER_ERROR, "Internal Server Error");
+            }
         }
         catch (...)
         {
@@ -128,7 +223,109 @@ void http::HttpConnection::handle_request(std::function<void(const http::HttpReq
     }
 }
 
-void http::HttpConnection::read_and_build_request_head()
+bool http::HttpConnection::respond_from_cache(ResponseCache &cache)
+{
+    std::string key;
+    if (!cache.make_key(current_request.request, key))
+    {
+        return false;
+    }
+    std::shared_ptr<const ResponseCache::Entry> entry = cache.find(key, ResponseCache::Clock::now());
+    if (!entry)
+    {
+        return false;
+    }
+
+    log_info(current_request.request.method() + " " + current_request.request.uri() + " (cached)");
+    const auto &headers = current_request.request.headers();
+    auto if_none_match = headers.find(http::headers::IF_NONE_MATCH);
+    bool not_modified = entry->not_modified && if_none_match != headers.end() && ResponseCache::etag_matches(if_none_match->second, entry->etag);
+    current_response.response.set_snapshot(not_modified ? entry->not_modified : entry->response);
+    current_request.status = RequestStatus::REQUEST_HANDLING_DONE;
+    return true;
+}
+
+void http::HttpConnection::store_in_cache(ResponseCache &cache) noexcept
+{
+    try
+    {
+        std::string key;
+        if (current_request.status != RequestStatus::REQUEST_HANDLING_DONE || !cache.make_key(current_request.request, key))
+        {
+            return;
+        }
+        std::shared_ptr<const ResponseCache::Entry> entry = cache.store(key, current_response.response, ResponseCache::Clock::now());
+        if (!entry)
+        {
+            return;
+        }
+
+        const auto &headers = current_request.request.headers();
+        auto if_none_match = headers.find(http::headers::IF_NONE_MATCH);
+        bool not_modified = entry->not_modified && if_none_match != headers.end() && ResponseCache::etag_matches(if_none_match->second, entry->etag);
+        current_response.response.set_snapshot(not_modified ? entry->not_modified : entry->response);
+        current_response.cache_entry = entry;
+    }
+    catch (const std::exception &e)
+    {
+        // The response is still sent, only without caching it.
+        log_error(std::string("Error caching response: ") + e.what());
+    }
+}
+
+bool http::HttpConnection::join_flight(RequestCoalescer &coalescer, const ResponseSharing &sharing)
+{
+    std::string key;
+    if (!sharing.make_key(current_request.request, key))
+    {
+        return false;
+    }
+    if (coalescer.join(key, *this))
+    {
+        log_info(current_request.request.method() + " " + current_request.request.uri() + " (coalesced)");
+        current_request.status = RequestStatus::COALESCED;
+        return true;
+    }
+    current_request.flight_key = std::move(key);
+    return false;
+}
+
+http::HttpResponseSnapshot http::HttpConnection::share_response(const ResponseSharing &sharing) noexcept
+{
+    try
+    {
+        if (current_response.cache_entry)
+        {
+            // The response itself may be the 304 for this request's If-None-Match.
+            return current_response.cache_entry->response;
+        }
+        if (inactive || current_request.status != RequestStatus::REQUEST_HANDLING_DONE || !sharing.is_shareable(current_response.response))
+        {
+            return HttpResponseSnapshot();
+        }
+        HttpResponseSnapshot snapshot = current_response.response.freeze();
+        current_response.response.set_snapshot(snapshot);
+        return snapshot;
+    }
+    catch (const std::exception &e)
+    {
+        log_error(std::string("Error sharing response: ") + e.what());
+        return HttpResponseSnapshot();
+    }
+}
+
+void http::HttpConnection::respond_with(const HttpResponseSnapshot &snapshot)
+{
+    current_response.response.set_snapshot(snapshot);
+    current_request.status = RequestStatus::REQUEST_HANDLING_DONE;
+}
+
+void http::HttpConnection::leave_flight() noexcept
+{
+    current_request.status = RequestStatus::HEADERS_DONE;
+}
+
+void http::HttpConnection::read_and_build_request_head(size_t io_quantum)
 {
     try
     {
@@ -138,10 +335,16 @@ void http::HttpConnection::read_and_build_request_head()
             HttpRequestBuilder::set_ip(current_request.request, get_ip());
             HttpRequestBuilder::set_port(current_request.request, std::to_string(get_port()));
             current_request.status = RequestStatus::READING_REQUEST_LINE;
-            buffer.resize(std::max(sizes::MAX_HEADER_SIZE, sizes::MAX_REQUEST_LINE_SIZE));
         }
 
-        read_from_client();
+        size_t bytes_received = read_from_client(io_quantum);
+        input_pending = bytes_received == io_quantum;
+        if (buffer_size == 0)
+        {
+            // Nothing of the next request has arrived yet, an idle connection does not keep a buffer.
+            release_buffer();
+            return;
+        }
 
         if (current_request.status == RequestStatus::READING_REQUEST_LINE)
         {
@@ -149,13 +352,16 @@ void http::HttpConnection::read_and_build_request_head()
         }
         if (current_request.status == RequestStatus::REQUEST_LINE_DONE)
         {
-            if (!http::HttpParser::validate_request_line(buffer))
+            // The head is parsed in place, parser_cursor marks where the headers start.
+            parser_cursor = buffer_cursor;
+            IoBuffer request_line(window().data(), parser_cursor);
+            if (!http::HttpParser::validate_request_line(request_line))
             {
                 throw http::exceptions::InvalidRequestLine();
             }
             else
             {
-                http::HttpRequestLine req_line = http::HttpParser::parse_request_line(buffer, parser_cursor);
+                http::HttpRequestLine req_line = http::HttpParser::parse_request_line(request_line);
                 HttpRequestBuilder::set_method(current_request.request, req_line.method);
                 HttpRequestBuilder::set_uri(current_request.request, req_line.uri);
                 HttpRequestBuilder::set_version(current_request.request, req_line.version);
@@ -165,17 +371,30 @@ void http::HttpConnection::read_and_build_request_head()
                 }
 
                 current_request.status = RequestStatus::READING_HEADERS;
-                read_headers();
-                reposition_buffer();
             }
         }
         if (current_request.status == RequestStatus::READING_HEADERS)
         {
             read_headers();
         }
+        if ((current_request.status == RequestStatus::READING_REQUEST_LINE || current_request.status == RequestStatus::READING_HEADERS) && buffer_size == static_cast<int64_t>(buffer.size()))
+        {
+            // The head is parsed in place, so it has to fit into one buffer.
+            if (buffer.size() >= config->max_request_line_size + config->max_header_size)
+            {
+                if (current_request.status == RequestStatus::READING_REQUEST_LINE)
+                {
+                    throw http::exceptions::RequestLineTooLong();
+                }
+                throw http::exceptions::HeadersTooLarge();
+            }
+            grow_buffer(buffer.size() * 2);
+            // The socket may still hold bytes that did not fit.
+            input_pending = true;
+        }
         if (current_request.status == RequestStatus::HEADERS_DONE)
         {
-            auto headers = http::HttpParser::parse_headers(buffer, parser_cursor);
+            auto headers = http::HttpParser::parse_headers(IoBuffer(window().data(), buffer_cursor), parser_cursor);
             for (auto &header : headers)
             {
                 HttpRequestBuilder::set_header(current_request.request, header.first, header.second);
@@ -235,14 +454,14 @@ void http::HttpConnection::read_and_build_request_head()
     {
         log_error(std::string(e.what()));
         current_request.status = RequestStatus::CLIENT_ERROR;
-        current_response.response = http::HttpResponseBuilder::build(http::status_codes::URI_TOO_LONG, "Invalid Request Line");
+        current_response.response = http::HttpResponseBuilder::build(http::status_codes::URI_TOO_LONG, "URI Too Long");
         return;
     }
     catch (const http::exceptions::HeadersTooLarge &e)
     {
         log_error(std::string(e.what()));
         current_request.status = RequestStatus::CLIENT_ERROR;
-        current_response.response = http::HttpResponseBuilder::build(http::status_codes::HEADERS_TOO_LARGE, "Header Fields Too Large");
+        current_response.response = http::HttpResponseBuilder::build(http::status_codes::HEADERS_TOO_LARGE, "Request Header Fields Too Large");
         return;
     }
     catch (const http::exceptions::VersionNotSupported &e)
@@ -280,10 +499,11 @@ void http::HttpConnection::read_request_line()
     try
     {
         bool found_end_of_request_line{false};
+        const char *data = window().data();
         for (; buffer_cursor < buffer_size - 1; buffer_cursor++)
         {
             current_request.request_line_bytes_read++;
-            if (buffer[buffer_cursor] == '\r' && buffer[buffer_cursor + 1] == '\n')
+            if (data[buffer_cursor] == '\r' && data[buffer_cursor + 1] == '\n')
             {
                 found_end_of_request_line = true;
                 buffer_cursor += 2;
@@ -292,7 +512,7 @@ void http::HttpConnection::read_request_line()
                 break;
             }
 
-            if (current_request.request_line_bytes_read >= http::sizes::MAX_REQUEST_LINE_SIZE)
+            if (static_cast<size_t>(current_request.request_line_bytes_read) >= config->max_request_line_size)
             {
                 throw http::exceptions::RequestLineTooLong();
             }
@@ -311,10 +531,11 @@ void http::HttpConnection::read_headers()
     try
     {
         bool found_end_of_headers{false};
+        const char *data = window().data();
         for (; buffer_cursor < buffer_size - 1; buffer_cursor++)
         {
             current_request.header_bytes_read++;
-            if (buffer[buffer_cursor] == '\r' && buffer[buffer_cursor + 1] == '\n')
+            if (data[buffer_cursor] == '\r' && data[buffer_cursor + 1] == '\n')
             {
                 if (buffer_cursor == current_request.last_header_end + 2)
                 {
@@ -327,7 +548,7 @@ void http::HttpConnection::read_headers()
                 buffer_cursor++;
             }
 
-            if (current_request.header_bytes_read >= http::sizes::MAX_HEADER_SIZE)
+            if (static_cast<size_t>(current_request.header_bytes_read) >= config->max_header_size)
             {
                 throw http::exceptions::HeadersTooLarge();
             }
@@ -350,48 +571,17 @@ void http::HttpConnection::read_body(size_t max_request_body_size)
 
     if (current_request.has_chunked_body)
     {
-        if (current_request.remaining_content_length == 0)
-        {
-            int64_t chunk_size = read_chunksize_line();
-            if (chunk_size == 0)
-            {
-                current_request.status = RequestStatus::REQUEST_READING_DONE;
-                return;
-            }
-            else if (chunk_size > 0)
-            {
-                if ((size_t)current_request.total_body_bytes_read + (size_t)chunk_size > max_request_body_size)
-                {
-                    throw http::exceptions::PayloadTooLarge();
-                }
-                current_request.remaining_content_length = chunk_size;
-            }
-        }
-        if (current_request.remaining_content_length > 0)
-        {
-            int64_t bytes_read = read_body_chunk();
-            current_request.remaining_content_length -= bytes_read;
-            current_request.body_end_cursor += bytes_read;
-            current_request.total_body_bytes_read += bytes_read;
-            if ((size_t)current_request.total_body_bytes_read > max_request_body_size)
-            {
-                throw http::exceptions::PayloadTooLarge();
-            }
-            if (current_request.remaining_content_length == 0)
-            {
-                buffer_cursor += 2; // To skip the \r\n after chunk data
-                read_body(max_request_body_size);
-            }
-        }
+        read_chunked_body(max_request_body_size);
     }
     else if (current_request.content_length != -1 && current_request.remaining_content_length > 0)
     {
         int64_t bytes_read = read_fixed_body();
         current_request.remaining_content_length -= bytes_read;
-        current_request.body_end_cursor += bytes_read;
         current_request.total_body_bytes_read += bytes_read;
         if ((size_t)current_request.total_body_bytes_read > max_request_body_size)
         {
+            current_request.status = RequestStatus::CLIENT_ERROR;
+            current_request.rejected_body_status = http::status_codes::PAYLOAD_TOO_LARGE;
             throw http::exceptions::PayloadTooLarge();
         }
         if (current_request.remaining_content_length == 0)
@@ -401,66 +591,117 @@ void http::HttpConnection::read_body(size_t max_request_body_size)
     }
 }
 
-int64_t http::HttpConnection::read_fixed_body()
+http::DataStream http::HttpConnection::decode_body_stream(DataStream &&body_stream, size_t max_request_body_size)
 {
-    size_t bytes_to_read = std::min((size_t)(buffer.size() - buffer_cursor), (size_t)current_request.remaining_content_length);
-    buffer_cursor += bytes_to_read;
-    return bytes_to_read;
-}
-
-int64_t http::HttpConnection::read_chunksize_line() // For chunked transfer encoding
-{
-    try
+    const auto &headers = current_request.request.headers();
+    auto content_encoding = headers.find(http::headers::CONTENT_ENCODING);
+    if (content_encoding == headers.end())
     {
-        int64_t pos = buffer_cursor;
-        while (true)
+        return std::move(body_stream);
+    }
+    std::shared_ptr<CompressionCodec> codec = ResponseCompression::find_codec(content_encoding->second, config->compression_codecs);
+    std::unique_ptr<Decompressor> decompressor = codec ? codec->create_decompressor() : nullptr;
+    if (!decompressor)
+    {
+        // Codings the server can not decode reach the handler as they are.
+        return std::move(body_stream);
+    }
+
+    auto decoder = std::make_shared<RequestBodyDecoder>(std::move(body_stream), std::move(decompressor), config->io_buffer_size, max_request_body_size);
+    DataStream decoded_stream;
+    decoded_stream.set_stream_updater(
+        [this, decoder]()
         {
-            bool found_end_of_chunk_size_line{false};
-            for (; pos < (int64_t)buffer.size() - 1; pos++)
+            try
             {
-                if (buffer[pos] == '\r' && buffer[pos + 1] == '\n')
-                {
-                    found_end_of_chunk_size_line = true;
-                    break;
-                }
+                decoder->decode_more();
+            }
+            catch (const http::exceptions::PayloadTooLarge &)
+            {
+                current_request.status = RequestStatus::CLIENT_ERROR;
+                current_request.rejected_body_status = http::status_codes::PAYLOAD_TOO_LARGE;
+                throw;
+            }
+            catch (const http::exceptions::InvalidContentEncoding &)
+            {
+                current_request.status = RequestStatus::CLIENT_ERROR;
+                current_request.rejected_body_status = http::status_codes::BAD_REQUEST;
+                throw;
             }
-            if (!found_end_of_chunk_size_line)
-                return -1;
+        });
+    decoded_stream.set_stream_view_provider(
+        [decoder]() -> DataStream::StreamView
+        {
+            return decoder->view();
+        });
+    decoded_stream.set_cursor_advancer(
+        [decoder](size_t bytes)
+        {
+            decoder->advance(bytes);
+        });
+    return decoded_stream;
+}
 
-            std::string chunk_size_str(buffer.begin() + buffer_cursor, buffer.begin() + pos);
-            size_t chunk_size = std::stoul(chunk_size_str, nullptr, 16);
+int64_t http::HttpConnection::read_fixed_body()
+{
+    size_t bytes_to_read = std::min((size_t)(buffer_size - buffer_cursor), (size_t)current_request.remaining_content_length);
+    current_request.body_stream_cursor = buffer_cursor;
+    current_request.body_end_cursor = buffer_cursor + bytes_to_read;
+    buffer_cursor += bytes_to_read;
+    return bytes_to_read;
+}
 
-            buffer_cursor = pos + 2;
+void http::HttpConnection::read_chunked_body(size_t max_request_body_size)
+{
+    // Chunk data is handed out in place; only the framing around it is consumed.
+    size_t cursor = buffer_cursor;
+    ChunkedDecoder::Span span;
+    ChunkedDecoder::Status status = current_request.chunked_decoder.decode(window().data(), buffer_size, cursor, span);
+    buffer_cursor = cursor;
 
-            return chunk_size;
-        }
+    if (status == ChunkedDecoder::INVALID)
+    {
+        current_request.status = RequestStatus::CLIENT_ERROR;
+        current_request.rejected_body_status = http::status_codes::BAD_REQUEST;
+        throw http::exceptions::InvalidChunkedEncoding();
     }
-    catch (...)
+    if (status == ChunkedDecoder::DONE)
     {
-        throw;
+        current_request.status = RequestStatus::REQUEST_READING_DONE;
+        return;
+    }
+    if (status == ChunkedDecoder::DATA)
+    {
+        current_request.total_body_bytes_read += span.length;
+        // The announced rest of the chunk counts as well, so an oversized chunk is refused before its data arrives.
+        if ((size_t)current_request.total_body_bytes_read + current_request.chunked_decoder.remaining_in_chunk() > max_request_body_size)
+        {
+            current_request.status = RequestStatus::CLIENT_ERROR;
+            current_request.rejected_body_status = http::status_codes::PAYLOAD_TOO_LARGE;
+            throw http::exceptions::PayloadTooLarge();
+        }
+        current_request.body_stream_cursor = span.offset;
+        current_request.body_end_cursor = span.offset + span.length;
     }
 }
 
-int64_t http::HttpConnection::read_body_chunk()
-{
-    size_t bytes_to_read = std::min((size_t)(buffer.size() - buffer_cursor), (size_t)current_request.remaining_content_length);
-    memmove(buffer.data() + current_request.body_end_cursor, buffer.data() + buffer_cursor, bytes_to_read);
-    buffer_cursor += bytes_to_read;
-    return bytes_to_read;
-}
-
-void http::HttpConnection::read_from_client()
+size_t http::HttpConnection::read_from_client(size_t max_bytes)
 {
     try
     {
         // While reading request body client socket will not be managed by epoll and there will be no need to empty the socket while reading.
         bool read_once = current_request.status == RequestStatus::READING_BODY;
-        auto bytes_received = client_socket.receive_data(buffer, buffer_cursor, read_once);
+        // New bytes are appended after the valid data, buffer_cursor may still point at unparsed bytes.
+        acquire_buffer();
+        size_t free_space = buffer.size() - buffer_size;
+        auto bytes_received = client_socket.receive_data(window().data() + buffer_size, free_space, read_once, max_bytes);
+        buffer_filled = free_space != 0 && bytes_received == free_space;
         if (bytes_received > 0)
         {
             last_activity_time = time(nullptr);
             buffer_size += bytes_received;
         }
+        return bytes_received;
     }
     catch (const tcp::exceptions::CanNotReceiveData &e)
     {
@@ -474,138 +715,250 @@ void http::HttpConnection::read_from_client()
     }
 }
 
-void http::HttpConnection::send_response()
+void http::HttpConnection::send_response(size_t io_quantum)
 {
     try
     {
         if (current_request.status == RequestStatus::CLIENT_ERROR || current_request.status == RequestStatus::SERVER_ERROR || current_request.status == RequestStatus::REQUEST_HANDLING_DONE)
         {
             client_socket.set_socket_non_blocking();
+            acquire_buffer();
             buffer_size = 0;
             buffer_cursor = 0;
-            current_response.response.set_header("Connection", "close");
-            current_request.status = RequestStatus::SENDING_STATUS_LINE;
-
-            int64_t content_length = HttpParser::has_content_length_header(current_response.response.headers());
-            bool has_chunked_encoding = HttpParser::has_transfer_encoding_chunked_header(current_response.response.headers());
-
-            if (content_length != -1 && has_chunked_encoding)
+            if (current_request.status == RequestStatus::REQUEST_HANDLING_DONE && config->range_requests)
             {
-                throw http::exceptions::BothContentLengthAndChunked();
+                select_ranges();
             }
+            current_request.status = RequestStatus::SENDING_RESPONSE_HEAD;
 
-            if (content_length == -1 && !has_chunked_encoding)
+            HttpResponseReader::SnapshotView snapshot;
+            if (HttpResponseReader::preformatted_head(current_response.response))
             {
-                current_response.response.set_header(http::headers::CONTENT_LENGTH, "0");
+                // Server-generated error, its constant head already closes the connection and announces an empty body.
                 current_response.content_length = 0;
                 current_response.remaining_content_length = 0;
             }
-            else
+            else if (HttpResponseReader::snapshot_view(current_response.response, snapshot))
             {
-                current_response.has_chunked_body = has_chunked_encoding;
-                current_response.content_length = content_length;
-                current_response.remaining_content_length = content_length;
+                // The snapshot bytes carry the connection and length headers and the body.
+                current_response.content_length = 0;
+                current_response.remaining_content_length = 0;
             }
-        }
-
-        if (current_request.status == RequestStatus::SENDING_STATUS_LINE)
-        {
-            size_t bytes_written = HttpParser::encode_response_status_line(current_response.response.version(), current_response.response.status_code(), current_response.response.reason_phrase(), buffer, buffer_size);
-            if (bytes_written != 0)
+            else if (HttpResponseReader::file_body(current_response.response))
             {
-                buffer_size += bytes_written;
-                current_request.status = RequestStatus::SENDING_HEADERS;
-                current_response.currently_sending_header = current_response.response.headers().begin();
+                // Sent as it is after the head, neither compressed nor copied through the buffer.
+                uint64_t body_size = 0;
+                for (const BodyPart &part : HttpResponseReader::file_parts(current_response.response))
+                {
+                    body_size += part.prefix.size() + part.length;
+                }
+                current_response.response.set_header("Connection", "close");
+                current_response.response.set_header(http::headers::CONTENT_LENGTH, std::to_string(body_size));
+                HttpResponseBuilder::remove_header(current_response.response, http::headers::TRANSFER_ENCODING);
+                current_response.content_length = 0;
+                current_response.remaining_content_length = 0;
             }
             else
             {
-                log_error("Status line too large.");
-                throw http::exceptions::StatusLineTooLong();
+                current_response.response.set_header("Connection", "close");
+
+                int64_t content_length = HttpParser::has_content_length_header(current_response.response.headers());
+                bool has_chunked_encoding = HttpParser::has_transfer_encoding_chunked_header(current_response.response.headers());
+
+                if (content_length != -1 && has_chunked_encoding)
+                {
+                    throw http::exceptions::BothContentLengthAndChunked();
+                }
+
+                if (content_length == -1 && !has_chunked_encoding)
+                {
+                    int status_code = current_response.response.status_code();
+                    if (status_code >= 200 && status_code != 204 && status_code != 304)
+                    {
+                        // 1xx, 204 and 304 never have a body and must not announce one.
+                        current_response.response.set_header(http::headers::CONTENT_LENGTH, "0");
+                    }
+                    current_response.content_length = 0;
+                    current_response.remaining_content_length = 0;
+                }
+                else if (!start_compression(content_length))
+                {
+                    current_response.has_chunked_body = has_chunked_encoding;
+                    current_response.content_length = content_length;
+                    current_response.remaining_content_length = content_length;
+                }
             }
         }
 
-        if (current_request.status == RequestStatus::SENDING_HEADERS)
+        size_t bytes_sent_this_turn = 0;
+        while (true)
         {
-            while (current_response.currently_sending_header != current_response.response.headers().end())
+            if (buffer.mirrored() && buffer_cursor > 0)
             {
-                size_t bytes_written = HttpParser::encode_response_header(current_response.currently_sending_header->first, current_response.currently_sending_header->second, buffer, buffer_size);
-                if (bytes_written != 0)
+                // Hand the space of already sent bytes back to the ring so it can be refilled before it drains completely.
+                reposition_buffer();
+            }
+            IoBuffer out = window();
+
+            if (current_request.status == RequestStatus::SENDING_RESPONSE_HEAD)
+            {
+                HttpResponseReader::SnapshotView snapshot;
+                bool has_snapshot = HttpResponseReader::snapshot_view(current_response.response, snapshot);
+                const std::string *preformatted_head = HttpResponseReader::preformatted_head(current_response.response);
+                auto encode_head = [&](IoBuffer &head_buffer) -> size_t
                 {
-                    buffer_size += bytes_written;
-                    ++current_response.currently_sending_header;
+                    if (has_snapshot)
+                    {
+                        // Only the status line and the cached lines are copied, the rest is sent from the snapshot.
+                        return HttpParser::encode_status_line(snapshot.data, snapshot.status_line_size, header_cache, !snapshot.has_date_header, !snapshot.has_server_header, head_buffer, buffer_size);
+                    }
+                    if (preformatted_head)
+                    {
+                        return HttpParser::encode_preformatted_head(*preformatted_head, header_cache, head_buffer, buffer_size);
+                    }
+                    return HttpParser::encode_response_head(current_response.response, header_cache, head_buffer, buffer_size);
+                };
+
+                size_t bytes_written = encode_head(out);
+                if (bytes_written == 0)
+                {
+                    // Only heads with many or long headers get here, the buffer grows so the head is still written in one piece.
+                    size_t head_size = has_snapshot        ? snapshot.status_line_size + HttpParser::cached_lines_size(header_cache, !snapshot.has_date_header, !snapshot.has_server_header)
+                                       : preformatted_head ? HttpParser::preformatted_head_size(*preformatted_head, header_cache)
+                                                           : HttpParser::response_head_size(current_response.response, header_cache);
+                    if (buffer_size + head_size > buffer_pool->max_block_size())
+                    {
+                        log_error("Response head too large.");
+                        throw http::exceptions::ResponseHeadTooLarge();
+                    }
+                    grow_buffer(buffer_size + head_size);
+                    out = window();
+                    bytes_written = encode_head(out);
+                }
+                buffer_size += bytes_written;
+                if (has_snapshot)
+                {
+                    current_response.snapshot_cursor = snapshot.status_line_size;
+                    current_request.status = RequestStatus::SENDING_SNAPSHOT;
+                }
+                else if (HttpResponseReader::file_body(current_response.response))
+                {
+                    current_response.file_part = 0;
+                    current_response.file_cursor = 0;
+                    current_response.file_prefix_written = false;
+                    current_request.status = RequestStatus::SENDING_FILE;
                 }
                 else
                 {
-                    break;
+                    current_request.status = RequestStatus::SENDING_RESPONSE_HEAD_DONE;
                 }
             }
 
-            if (current_response.currently_sending_header == current_response.response.headers().end())
+            if (current_request.status == RequestStatus::SENDING_SNAPSHOT)
             {
-                size_t bytes_written = HttpParser::encode_end_of_headers(buffer, buffer_size);
-                if (bytes_written != 0)
+                bytes_sent_this_turn += send_snapshot_to_client(io_quantum - bytes_sent_this_turn);
+                HttpResponseReader::SnapshotView snapshot;
+                HttpResponseReader::snapshot_view(current_response.response, snapshot);
+                if (buffer_cursor == buffer_size && current_response.snapshot_cursor == snapshot.size)
                 {
-                    buffer_size += bytes_written;
-                    current_request.status = RequestStatus::SENDING_RESPONSE_HEAD_DONE;
+                    log_info(std::to_string(current_response.response.status_code()) + " " + current_response.response.reason_phrase());
+                    current_request.status = RequestStatus::COMPLETED;
                 }
+                // Everything pending was offered to the socket, whatever is left waits for it to drain or for the next quantum.
+                break;
             }
-        }
-
-        if (current_request.status == RequestStatus::SENDING_RESPONSE_HEAD_DONE)
-        {
-            current_request.status = RequestStatus::SENDING_BODY;
-        }
 
-        if (current_request.status == RequestStatus::SENDING_BODY)
-        {
-            if (current_response.has_fixed_length_body())
+            if (current_request.status == RequestStatus::SENDING_FILE)
             {
-                int64_t bytes_read = HttpResponseReader::read_body_stream(current_response.response, buffer, buffer_size);
-                if (bytes_read == -1)
+                bytes_sent_this_turn += send_file_to_client(io_quantum - bytes_sent_this_turn);
+                if (buffer_cursor == buffer_size && current_response.file_part == HttpResponseReader::file_parts(current_response.response).size())
                 {
-                    if (current_response.remaining_content_length != 0)
-                    {
-                        throw http::exceptions::UnexpectedEndOfStream();
-                    }
-                }
-                buffer_size += bytes_read;
-                current_response.remaining_content_length -= bytes_read;
-                if (current_response.remaining_content_length == 0)
-                {
-                    current_request.status = RequestStatus::SENDING_BUFFER_FLUSHING;
+                    log_info(std::to_string(current_response.response.status_code()) + " " + current_response.response.reason_phrase());
+                    current_request.status = RequestStatus::COMPLETED;
                 }
+                break;
             }
-            else if (current_response.has_chunked_body)
+
+            if (current_request.status == RequestStatus::SENDING_RESPONSE_HEAD_DONE)
+            {
+                current_request.status = RequestStatus::SENDING_BODY;
+            }
+
+            if (current_request.status == RequestStatus::SENDING_BODY)
             {
-                // Read only if a certain minimum buffer size is available.
-                if (buffer.size() - buffer_size > 128) // Placeholder
+                body_starved = false;
+                if (current_response.has_fixed_length_body())
                 {
-                    size_t maximum_chunk_size = buffer.size() - buffer_size - 6 - 2;                                                                // 6 is Empty space for chunk size in hex and \r\n, 2 is for the ending \r\n after chunk data.
-                    int64_t bytes_read = HttpResponseReader::read_body_stream(current_response.response, buffer, buffer_size + 6, maximum_chunk_size); // 6 is Empty space for chunk size in hex and \r\n.
-                    if (bytes_read > 0)
+                    // Body is pulled only while the buffer has room and bytes are still owed to the peer.
+                    if (current_response.remaining_content_length > 0 && buffer_size < (int64_t)buffer.size())
                     {
-                        size_t bytes_encoded = HttpParser::encode_chunksize_line(bytes_read, 4, buffer, buffer_size); // in HHHH format.
-                        buffer_size += bytes_read + bytes_encoded;
-                        size_t chunk_end_bytes = HttpParser::encode_chunk_end(buffer, buffer_size);
-                        buffer_size += chunk_end_bytes;
+                        int64_t bytes_read = HttpResponseReader::read_body_stream(current_response.response, out, buffer_size, current_response.remaining_content_length);
+                        if (bytes_read == -1)
+                        {
+                            throw http::exceptions::UnexpectedEndOfStream();
+                        }
+                        buffer_size += bytes_read;
+                        current_response.remaining_content_length -= bytes_read;
+                        body_starved = bytes_read == 0;
                     }
-                    if (bytes_read == -1)
+                    if (current_response.remaining_content_length == 0)
                     {
-                        size_t bytes_encoded = HttpParser::encode_chunksize_line(0, 1, buffer, buffer_size); // Last chunk with size 0.
-                        buffer_size += bytes_encoded;
-                        size_t chunk_end_bytes = HttpParser::encode_chunk_end(buffer, buffer_size);
-                        buffer_size += chunk_end_bytes;
                         current_request.status = RequestStatus::SENDING_BUFFER_FLUSHING;
                     }
                 }
+                else if (current_response.has_chunked_body)
+                {
+                    // Read only if a certain minimum buffer size is available.
+                    if (buffer.size() - buffer_size > 128) // Placeholder
+                    {
+                        // The size line is written in front of the data once its length is known, so room for the widest size is reserved.
+                        unsigned int size_width = HttpParser::chunksize_width(buffer.size() - buffer_size);
+                        size_t size_line_length = size_width + 2;
+                        size_t maximum_chunk_size = buffer.size() - buffer_size - size_line_length - 2; // 2 is for the ending \r\n after chunk data.
+                        int64_t bytes_read = current_response.compressor ? read_compressed_body(out, buffer_size + size_line_length, maximum_chunk_size)
+                                                                         : HttpResponseReader::read_body_stream(current_response.response, out, buffer_size + size_line_length, maximum_chunk_size);
+                        if (bytes_read > 0)
+                        {
+                            size_t bytes_encoded = HttpParser::encode_chunksize_line(bytes_read, size_width, out, buffer_size); // Zero padded to size_width digits.
+                            buffer_size += bytes_read + bytes_encoded;
+                            size_t chunk_end_bytes = HttpParser::encode_chunk_end(out, buffer_size);
+                            buffer_size += chunk_end_bytes;
+                        }
+                        body_starved = bytes_read == 0;
+                        if (bytes_read == -1)
+                        {
+                            size_t bytes_encoded = HttpParser::encode_chunksize_line(0, 1, out, buffer_size); // Last chunk with size 0.
+                            buffer_size += bytes_encoded;
+                            size_t chunk_end_bytes = HttpParser::encode_chunk_end(out, buffer_size);
+                            buffer_size += chunk_end_bytes;
+                            current_request.status = RequestStatus::SENDING_BUFFER_FLUSHING;
+                        }
+                    }
+                }
             }
-        }
-        send_to_client();
+            size_t bytes_pending = buffer_size - buffer_cursor;
+            size_t bytes_sent = send_to_client(io_quantum - bytes_sent_this_turn);
+            bytes_sent_this_turn += bytes_sent;
 
-        if (current_request.status == RequestStatus::SENDING_BUFFER_FLUSHING && buffer_cursor == buffer_size)
-        {
-            log_info(std::to_string(current_response.response.status_code()) + " " + current_response.response.reason_phrase());
-            current_request.status = RequestStatus::COMPLETED;
+            if (current_request.status == RequestStatus::SENDING_BODY && bytes_sent == bytes_pending && bytes_pending * 2 >= buffer.size())
+            {
+                // The socket took a mostly full buffer without blocking, the buffer is what limits the transfer.
+                grow_send_buffer(io_quantum);
+            }
+
+            if (current_request.status == RequestStatus::SENDING_BUFFER_FLUSHING && buffer_cursor == buffer_size)
+            {
+                log_info(std::to_string(current_response.response.status_code()) + " " + current_response.response.reason_phrase());
+                current_request.status = RequestStatus::COMPLETED;
+                break;
+            }
+
+            // Stop when the socket would block, nothing could be produced, or this connection used up its quantum.
+            // Unfinished connections stay writable and are picked up again after the other ready connections.
+            if (bytes_sent == 0 || bytes_sent < bytes_pending || bytes_sent_this_turn >= io_quantum)
+            {
+                break;
+            }
         }
     }
     catch (std::exception &e)
@@ -622,11 +975,21 @@ void http::HttpConnection::send_response()
     }
 }
 
-void http::HttpConnection::send_to_client()
+std::shared_ptr<http::BodyProducer> http::HttpConnection::make_body_producer(size_t high_watermark, size_t low_watermark)
+{
+    return HttpResponseReader::make_body_producer(current_response.response, high_watermark, low_watermark);
+}
+
+bool http::HttpConnection::park_until_body_available()
+{
+    return HttpResponseReader::park_body_consumer(current_response.response);
+}
+
+size_t http::HttpConnection::send_to_client(size_t max_bytes)
 {
     try
     {
-        size_t bytes_sent = client_socket.send_data(buffer, buffer_cursor, buffer_size);
+        size_t bytes_sent = client_socket.send_data(window().data() + buffer_cursor, std::min(static_cast<size_t>(buffer_size - buffer_cursor), max_bytes));
         if (bytes_sent > 0)
         {
             last_activity_time = time(nullptr);
@@ -637,6 +1000,40 @@ void http::HttpConnection::send_to_client()
                 buffer_size = 0;
             }
         }
+        return bytes_sent;
+    }
+    catch (const tcp::exceptions::CanNotSendData &e)
+    {
+        throw http::exceptions::UnexpectedEndOfStream(std::string(e.what()));
+    }
+    catch (...)
+    {
+        throw http::exceptions::UnexpectedEndOfStream();
+    }
+}
+
+size_t http::HttpConnection::send_snapshot_to_client(size_t max_bytes)
+{
+    try
+    {
+        HttpResponseReader::SnapshotView snapshot;
+        HttpResponseReader::snapshot_view(current_response.response, snapshot);
+        size_t buffer_pending = std::min(static_cast<size_t>(buffer_size - buffer_cursor), max_bytes);
+        size_t snapshot_pending = std::min(snapshot.size - current_response.snapshot_cursor, max_bytes - buffer_pending);
+        size_t bytes_sent = client_socket.send_data(window().data() + buffer_cursor, buffer_pending, snapshot.data + current_response.snapshot_cursor, snapshot_pending);
+        if (bytes_sent > 0)
+        {
+            last_activity_time = time(nullptr);
+            size_t buffer_sent = std::min(bytes_sent, buffer_pending);
+            buffer_cursor += buffer_sent;
+            if (buffer_cursor == buffer_size)
+            {
+                buffer_cursor = 0;
+                buffer_size = 0;
+            }
+            current_response.snapshot_cursor += bytes_sent - buffer_sent;
+        }
+        return bytes_sent;
     }
     catch (const tcp::exceptions::CanNotSendData &e)
     {
@@ -648,11 +1045,323 @@ void http::HttpConnection::send_to_client()
     }
 }
 
+size_t http::HttpConnection::send_file_to_client(size_t max_bytes)
+{
+    try
+    {
+        const FileRegion &file_body = *HttpResponseReader::file_body(current_response.response);
+        const std::vector<BodyPart> &parts = HttpResponseReader::file_parts(current_response.response);
+        size_t bytes_sent = 0;
+        while (true)
+        {
+            if (buffer_cursor < buffer_size)
+            {
+                size_t bytes_pending = buffer_size - buffer_cursor;
+                size_t buffer_sent = send_to_client(max_bytes - bytes_sent);
+                bytes_sent += buffer_sent;
+                if (buffer_sent < bytes_pending)
+                {
+                    return bytes_sent;
+                }
+            }
+            if (current_response.file_part == parts.size())
+            {
+                return bytes_sent;
+            }
+
+            const BodyPart &part = parts[current_response.file_part];
+            if (!current_response.file_prefix_written)
+            {
+                // Part headers of a multipart body are short, they go through the buffer.
+                current_response.file_prefix_written = true;
+                if (!part.prefix.empty())
+                {
+                    grow_buffer(part.prefix.size());
+                    memcpy(window().data(), part.prefix.data(), part.prefix.size());
+                    buffer_size = part.prefix.size();
+                    continue;
+                }
+            }
+
+            uint64_t file_pending = std::min<uint64_t>(part.length - current_response.file_cursor, max_bytes - bytes_sent);
+            if (file_pending > 0)
+            {
+                size_t file_sent = client_socket.send_file(file_body.file->handle(), file_body.offset + part.offset + current_response.file_cursor, static_cast<size_t>(file_pending));
+                if (file_sent > 0)
+                {
+                    last_activity_time = time(nullptr);
+                    current_response.file_cursor += file_sent;
+                    bytes_sent += file_sent;
+                }
+                if (file_sent < file_pending)
+                {
+                    return bytes_sent;
+                }
+            }
+            if (current_response.file_cursor < part.length)
+            {
+                return bytes_sent; // Quantum used up.
+            }
+            ++current_response.file_part;
+            current_response.file_cursor = 0;
+            current_response.file_prefix_written = false;
+        }
+    }
+    catch (const tcp::exceptions::CanNotSendData &e)
+    {
+        throw http::exceptions::UnexpectedEndOfStream(std::string(e.what()));
+    }
+}
+
+void http::HttpConnection::select_ranges()
+{
+    HttpResponse &response = current_response.response;
+    if (response.status_code() != http::status_codes::OK || current_request.request.method() != http::methods::GET)
+    {
+        return;
+    }
+    const auto &request_headers = current_request.request.headers();
+    auto range = request_headers.find(http::headers::RANGE);
+    uint64_t size = 0;
+    if (range == request_headers.end() || !HttpResponseReader::body_size(response, size))
+    {
+        return;
+    }
+    const auto &headers = HttpResponseReader::sent_headers(response);
+    if (headers.count(http::headers::TRANSFER_ENCODING) != 0)
+    {
+        return;
+    }
+    auto if_range = request_headers.find(http::headers::IF_RANGE);
+    if (if_range != request_headers.end() && !ByteRanges::if_range_matches(if_range->second, headers))
+    {
+        return; // The client's parts are of another version, it gets the whole body.
+    }
+
+    std::vector<ByteRanges::Range> ranges;
+    ByteRanges::Result result = ByteRanges::parse(range->second, size, ranges);
+    if (result == ByteRanges::IGNORED)
+    {
+        return;
+    }
+    if (result == ByteRanges::NOT_SATISFIABLE)
+    {
+        HttpResponseBuilder::reset(response);
+        response.set_status_code(http::status_codes::RANGE_NOT_SATISFIABLE);
+        response.set_reason_phrase("Range Not Satisfiable");
+        response.set_header(http::headers::CONTENT_RANGE, ByteRanges::unsatisfied_range(size));
+        return;
+    }
+
+    auto content_type = headers.find(http::headers::CONTENT_TYPE);
+    std::string parts_content_type;
+    std::vector<BodyPart> parts = ByteRanges::select(ranges, size, content_type == headers.end() ? std::string() : content_type->second, parts_content_type);
+    uint64_t parts_size = 0;
+    for (const BodyPart &part : parts)
+    {
+        parts_size += part.prefix.size() + part.length;
+    }
+    HttpResponseBuilder::select_body_parts(response, std::move(parts));
+
+    response.set_status_code(http::status_codes::PARTIAL_CONTENT);
+    response.set_reason_phrase("Partial Content");
+    response.set_header(http::headers::CONTENT_LENGTH, std::to_string(parts_size));
+    if (ranges.size() == 1)
+    {
+        response.set_header(http::headers::CONTENT_RANGE, ByteRanges::content_range(ranges[0], size));
+    }
+    else
+    {
+        response.set_header(http::headers::CONTENT_TYPE, parts_content_type);
+    }
+}
+
+bool http::HttpConnection::start_compression(int64_t content_length)
+{
+    HttpResponse &response = current_response.response;
+    int status_code = response.status_code();
+    if (!config->compression || config->compression_codecs.empty() || content_length == 0 || status_code < 200 || status_code == 204 || status_code == 206 || status_code == 304)
+    {
+        return false;
+    }
+    const auto &headers = response.headers();
+    if (headers.count(http::headers::CONTENT_ENCODING) != 0)
+    {
+        return false;
+    }
+    auto content_type = headers.find(http::headers::CONTENT_TYPE);
+    if (content_type != headers.end() && !ResponseCompression::is_compressible_type(content_type->second, config->compression_excluded_types))
+    {
+        return false;
+    }
+    if (content_length != -1 && static_cast<size_t>(content_length) < config->compression_min_size)
+    {
+        return false;
+    }
+
+    // Caches have to keep the encodings apart even for clients that got the body as it is.
+    auto vary = headers.find(http::headers::VARY);
+    if (vary == headers.end())
+    {
+        response.set_header(http::headers::VARY, http::headers::ACCEPT_ENCODING);
+    }
+    else if (!ResponseCompression::list_contains(vary->second, "*") && !ResponseCompression::list_contains(vary->second, http::headers::ACCEPT_ENCODING))
+    {
+        response.set_header(http::headers::VARY, vary->second + ", " + http::headers::ACCEPT_ENCODING);
+    }
+
+    const auto &request_headers = current_request.request.headers();
+    auto accept_encoding = request_headers.find(http::headers::ACCEPT_ENCODING);
+    if (accept_encoding == request_headers.end())
+    {
+        return false;
+    }
+    std::shared_ptr<CompressionCodec> codec = ResponseCompression::negotiate(accept_encoding->second, config->compression_codecs);
+    if (!codec)
+    {
+        return false;
+    }
+
+    current_response.compressor = ResponseCompression::acquire_compressor(codec, config->compression_level);
+    current_response.codec = codec;
+    current_response.compression_input = buffer_pool->acquire();
+    current_response.uncompressed_remaining = content_length;
+
+    response.set_header(http::headers::CONTENT_ENCODING, codec->name());
+    HttpResponseBuilder::remove_header(response, http::headers::CONTENT_LENGTH);
+    response.set_header(http::headers::TRANSFER_ENCODING, "chunked");
+    auto etag = headers.find(http::headers::ETAG);
+    if (etag != headers.end() && etag->second.compare(0, 2, "W/") != 0)
+    {
+        // The compressed bytes differ from the ones a strong validator stands for.
+        response.set_header(http::headers::ETAG, "W/" + etag->second);
+    }
+
+    current_response.has_chunked_body = true;
+    current_response.content_length = -1;
+    current_response.remaining_content_length = -1;
+    return true;
+}
+
+int64_t http::HttpConnection::read_compressed_body(IoBuffer &out, size_t cursor, size_t max_size)
+{
+    CurrentResponse &current = current_response;
+    while (!current.compression_finished)
+    {
+        if (current.compression_input_cursor == current.compression_input_size && !current.uncompressed_done)
+        {
+            size_t max_read = current.compression_input.size();
+            if (current.uncompressed_remaining != -1)
+            {
+                max_read = std::min(max_read, static_cast<size_t>(current.uncompressed_remaining));
+            }
+            int64_t bytes_read = max_read == 0 ? -1 : HttpResponseReader::read_body_stream(current.response, current.compression_input, 0, max_read);
+            if (bytes_read == -1)
+            {
+                if (current.uncompressed_remaining > 0)
+                {
+                    throw http::exceptions::UnexpectedEndOfStream();
+                }
+                current.uncompressed_done = true;
+            }
+            else
+            {
+                current.compression_input_cursor = 0;
+                current.compression_input_size = bytes_read;
+                if (current.uncompressed_remaining != -1)
+                {
+                    current.uncompressed_remaining -= bytes_read;
+                }
+            }
+        }
+
+        // A starved body source gets what was compressed so far flushed, so streamed bodies are not held back.
+        bool starved = current.compression_input_cursor == current.compression_input_size && !current.uncompressed_done;
+        Compressor::Flush flush = current.uncompressed_done ? Compressor::FINISH : starved ? Compressor::SYNC_FLUSH : Compressor::NO_FLUSH;
+        Compressor::Result result = current.compressor->compress(current.compression_input.data() + current.compression_input_cursor, current.compression_input_size - current.compression_input_cursor, out.data() + cursor, max_size, flush);
+        current.compression_input_cursor += result.consumed;
+        current.compression_finished = result.finished;
+        if (result.produced > 0)
+        {
+            return result.produced;
+        }
+        if (starved)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void http::HttpConnection::release_compression() noexcept
+{
+    if (current_response.compressor)
+    {
+        ResponseCompression::release_compressor(current_response.codec, config->compression_level, std::move(current_response.compressor));
+    }
+    buffer_pool->release(current_response.compression_input);
+}
+
+void http::HttpConnection::acquire_buffer()
+{
+    if (buffer.empty())
+    {
+        buffer = buffer_pool->acquire();
+    }
+}
+
+void http::HttpConnection::release_buffer() noexcept
+{
+    buffer_pool->release(buffer);
+    buffer_start = 0;
+}
+
+void http::HttpConnection::grow_buffer(size_t min_size)
+{
+    if (buffer.empty() || min_size <= buffer.size())
+    {
+        return;
+    }
+    IoBuffer grown = buffer_pool->acquire(min_size);
+    if (grown.size() <= buffer.size())
+    {
+        buffer_pool->release(grown);
+        return;
+    }
+    // The window is copied to the start of the new buffer, so all offsets into it stay valid.
+    memcpy(grown.data(), window().data(), buffer_size);
+    buffer_pool->release(buffer);
+    buffer = grown;
+    buffer_start = 0;
+}
+
+void http::HttpConnection::grow_send_buffer(size_t io_quantum)
+{
+    if (send_window == 0)
+    {
+        send_window = client_socket.send_buffer_size();
+    }
+    size_t limit = std::min(config->io_buffer_max_size, io_quantum);
+    if (send_window != 0)
+    {
+        limit = std::min(limit, send_window);
+    }
+    grow_buffer(std::min(buffer.size() * 2, limit));
+}
+
 void http::HttpConnection::reposition_buffer()
 {
     int64_t remaining_data = buffer_size - buffer_cursor;
     current_request.last_header_end -= buffer_cursor;
-    memmove(buffer.data(), buffer.data() + buffer_cursor, remaining_data);
+    if (buffer.mirrored())
+    {
+        // Only the ring start moves, bytes stay where they were received.
+        buffer_start = (buffer_start + buffer_cursor) % buffer.size();
+    }
+    else
+    {
+        memmove(buffer.data(), buffer.data() + buffer_cursor, remaining_data);
+    }
     buffer_cursor = 0;
     buffer_size = remaining_data;
     parser_cursor = 0;
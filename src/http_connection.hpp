@@ -4,8 +4,16 @@
 #include "http/http_request.hpp"
 #include "http/http_response.hpp"
 
+#include "buffer_pool.hpp"
+#include "chunked_decoder.hpp"
+#include "data_stream.hpp"
+#include "response_header_cache.hpp"
+#include "response_cache.hpp"
+#include "request_coalescer.hpp"
+#include "http/http_compression.hpp"
 #include "tcp.hpp"
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -15,6 +23,8 @@
 
 namespace http
 {
+    class BodyProducer;
+
     /// Request/response lifecycle states for a single connection.
     enum RequestStatus
     {
@@ -23,13 +33,16 @@ namespace http
         REQUEST_LINE_DONE,
         READING_HEADERS,
         HEADERS_DONE,
+        // Parked until the leader of its flight is handled, see RequestCoalescer.
+        COALESCED,
         READING_BODY,
         REQUEST_READING_DONE,
         REQUEST_HANDLING_DONE,
-        SENDING_STATUS_LINE,
-        SENDING_HEADERS,
+        SENDING_RESPONSE_HEAD,
         SENDING_RESPONSE_HEAD_DONE,
         SENDING_BODY,
+        SENDING_SNAPSHOT,
+        SENDING_FILE,
         SENDING_BUFFER_FLUSHING,
         COMPLETED,
         CLIENT_ERROR,
@@ -66,11 +79,21 @@ namespace http
             // Cursor into body bytes consumed from the shared connection buffer.
             int64_t body_stream_cursor = 0;
             // Cursor marking end of currently available body bytes in buffer.
+            // Body bytes are handed out where they were received, [body_stream_cursor, body_end_cursor) is a span of the buffer.
             int64_t body_end_cursor = 0;
+            // Framing state of a chunked body.
+            ChunkedDecoder chunked_decoder;
+            // Status code for a body the client got wrong, answered instead of 500 if the handler fails on it. 0 if none.
+            int rejected_body_status = 0;
+            // Key of the coalesced flight this request leads, empty if none.
+            std::string flight_key;
 
         public:
             CurrentRequest();
 
+            /// Clears parsing state for a new connection, keeping the request's allocations.
+            void reset();
+
             const RequestStatus get_status() const noexcept
             {
                 return status;
@@ -87,8 +110,27 @@ namespace http
             bool has_chunked_body = false;
             int64_t content_length = -1;
             int64_t remaining_content_length = -1;
-
-            std::unordered_map<std::string, std::string>::const_iterator currently_sending_header;
+            // Next byte of a response snapshot to send, see HttpResponse::set_snapshot.
+            size_t snapshot_cursor = 0;
+            // Part of a file body being sent and the next byte of it, see HttpResponseReader::file_parts.
+            size_t file_part = 0;
+            uint64_t file_cursor = 0;
+            // True once the prefix of file_part was put into the buffer.
+            bool file_prefix_written = false;
+            // Cache entry the response was stored as, see store_in_cache.
+            std::shared_ptr<const ResponseCache::Entry> cache_entry;
+
+            // Set while the body is compressed, see start_compression.
+            std::shared_ptr<CompressionCodec> codec;
+            std::unique_ptr<Compressor> compressor;
+            // Uncompressed body bytes waiting for the compressor, borrowed from the buffer pool.
+            IoBuffer compression_input;
+            size_t compression_input_cursor = 0;
+            size_t compression_input_size = 0;
+            // Uncompressed bytes still owed by a body with a Content-Length, -1 if unknown.
+            int64_t uncompressed_remaining = -1;
+            bool uncompressed_done = false;
+            bool compression_finished = false;
 
             bool has_fixed_length_body() const
             {
@@ -97,12 +139,21 @@ namespace http
 
         public:
             CurrentResponse(HttpResponse &&response) : response(std::move(response)) {}
+
+            /// Clears serialization state for a new connection, keeping the response's allocations.
+            void reset();
+
             friend class HttpConnection;
         };
 
     private:
-        // Shared byte buffer reused across request parsing and response writes.
-        std::vector<char> buffer;
+        // Byte buffer shared by request parsing and response writes, borrowed from buffer_pool while bytes are in flight.
+        IoBuffer buffer;
+        BufferPool *buffer_pool;
+        const HttpServerConfig *config;
+        const ResponseHeaderCache *header_cache;
+        // Offset of the first valid byte in buffer. Only a mirrored buffer is used as a ring, otherwise this stays 0.
+        size_t buffer_start = 0;
         tcp::ConnectionSocket client_socket;
         CurrentRequest current_request;
         CurrentResponse current_response;
@@ -111,26 +162,65 @@ namespace http
         int64_t buffer_size = 0;
         size_t parser_cursor = 0;
         int peer_status = ConnectionStatus::IDLE;
-
-        void read_from_client();
+        // True when the last read stopped at the I/O quantum and the socket may still hold unread bytes.
+        bool input_pending = false;
+        // True when the last body read found the response body source empty but not finished.
+        bool body_starved = false;
+        // True when the last socket read filled all free space in the buffer.
+        bool buffer_filled = false;
+        // Kernel send buffer size, queried the first time the write buffer may grow.
+        size_t send_window = 0;
+
+        size_t read_from_client(size_t max_bytes = static_cast<size_t>(-1));
         void read_request_line();
         void read_headers();
         void read_body(size_t max_request_body_size);
+        /// Wraps the request body stream in a decompressing one if the body has a Content-Encoding the server can decode.
+        DataStream decode_body_stream(DataStream &&body_stream, size_t max_request_body_size);
         int64_t read_fixed_body();
-        int64_t read_chunksize_line();
-        int64_t read_body_chunk();
+        void read_chunked_body(size_t max_request_body_size);
         void log_info(const std::string &message) const;
         void log_warning(const std::string &message) const;
         void log_error(const std::string &message) const;
 
-        void send_to_client();
+        size_t send_to_client(size_t max_bytes);
+        /// Sends the pending buffer bytes and the rest of the response snapshot in one gathered write.
+        /// @return Bytes sent, buffer and snapshot bytes together.
+        size_t send_snapshot_to_client(size_t max_bytes);
+        /// Sends the pending buffer bytes, then the rest of the file body straight from the file, part prefixes through the buffer.
+        /// @return Bytes sent, buffer and file bytes together.
+        size_t send_file_to_client(size_t max_bytes);
+        /// Narrows a handled 200 response to the byte ranges the request asks for, with 206 Partial Content or 416 Range Not Satisfiable.
+        void select_ranges();
+        /// Switches the response to a compressed, chunked body if the server, the response and the client's Accept-Encoding allow it.
+        /// @param content_length Content-Length set by the handler, -1 if none.
+        /// @return True if the body is compressed.
+        bool start_compression(int64_t content_length);
+        /// Compresses body bytes into out at cursor, same contract as HttpResponseReader::read_body_stream.
+        int64_t read_compressed_body(IoBuffer &out, size_t cursor, size_t max_size);
+        /// Returns the compressor and its input buffer.
+        void release_compression() noexcept;
 
         void reposition_buffer();
+        /// @return Contiguous view of the buffer starting at buffer_start; buffer_cursor and buffer_size are offsets into it.
+        IoBuffer window() noexcept
+        {
+            return IoBuffer(buffer.data() + buffer_start, buffer.size());
+        }
+        void acquire_buffer();
+        /// Moves the window into a buffer of at least min_size bytes from the pool; no-op if the buffer is already that large.
+        void grow_buffer(size_t min_size);
+        /// Doubles the buffer while a bulk response drains it in one send, up to io_buffer_max_size, io_quantum and the socket send buffer.
+        void grow_send_buffer(size_t io_quantum);
+        void release_buffer() noexcept;
 
     public:
         /// @brief Construct a new Http Connection object
         /// @param socket The TCP connection socket associated with this HTTP connection
-        explicit HttpConnection(tcp::ConnectionSocket &&socket);
+        /// @param buffer_pool Pool the I/O buffer is borrowed from
+        /// @param config Server configuration for buffer and header limits
+        /// @param header_cache Date and Server lines added to every response head
+        HttpConnection(tcp::ConnectionSocket &&socket, BufferPool &buffer_pool, const HttpServerConfig &config, const ResponseHeaderCache &header_cache);
 
         HttpConnection(const HttpConnection &) = delete;
         HttpConnection &operator=(const HttpConnection &) = delete;
@@ -138,15 +228,56 @@ namespace http
         HttpConnection(HttpConnection &&) = default;
         HttpConnection &operator=(HttpConnection &&) = default;
 
+        /// Attaches a newly accepted socket to a recycled connection object.
+        void open(tcp::ConnectionSocket &&socket);
+        /// Closes the socket and clears all request/response state so the object can be reused.
+        void close();
+
         bool inactive = false;
+        // True once the socket is registered with the response event manager; later waits only re-arm it.
+        bool write_registered = false;
 
         /// Reads from socket and advances parsing until request line + headers are complete.
-        void read_and_build_request_head();
+        /// Reads at most io_quantum bytes, has_pending_input() tells whether the socket needs another turn.
+        void read_and_build_request_head(size_t io_quantum);
         /// Executes user handler against the currently parsed request.
         void handle_request(std::function<void(const http::HttpRequest &, http::HttpResponse &)> &request_handler, size_t max_request_body_size) noexcept;
+        /// Answers the parsed request from the cache instead of the handler, with 304 Not Modified if its If-None-Match matches.
+        /// @return True on a hit; the response is then ready to send.
+        bool respond_from_cache(ResponseCache &cache);
+        /// Stores the handled response in the cache if request and response allow it, the response is then sent from the stored snapshot.
+        void store_in_cache(ResponseCache &cache) noexcept;
+        /// Starts or joins the flight of identical in-flight requests.
+        /// @return True if the request is parked until the flight's leader is handled; false if it leads the flight or is not coalesced.
+        bool join_flight(RequestCoalescer &coalescer, const ResponseSharing &sharing);
+        /// @return Key of the flight this request leads, empty if none.
+        const std::string &flight_key() const noexcept
+        {
+            return current_request.flight_key;
+        }
+        /// Freezes the handled response for the requests parked on this one's flight; it is then sent from the snapshot here too.
+        /// @return The snapshot, empty if the response can not be shared.
+        HttpResponseSnapshot share_response(const ResponseSharing &sharing) noexcept;
+        /// Answers a parked request with the response of its flight's leader.
+        void respond_with(const HttpResponseSnapshot &snapshot);
+        /// Returns a parked request to HEADERS_DONE so it runs the handler itself.
+        void leave_flight() noexcept;
 
         /// Serializes and sends response head/body according to current response state.
-        void send_response();
+        /// Returns after io_quantum bytes were sent, the socket would block, the body source ran dry, or the response is complete.
+        void send_response(size_t io_quantum);
+
+        /// Moves a generator response body onto a BodyProducer, see HttpResponseReader::make_body_producer.
+        std::shared_ptr<BodyProducer> make_body_producer(size_t high_watermark, size_t low_watermark);
+
+        /// @return True if everything produced so far was sent and the response body source has nothing buffered.
+        bool waiting_for_body() const noexcept
+        {
+            return body_starved && buffer_cursor == buffer_size;
+        }
+
+        /// Parks the response until its body producer publishes more bytes, see HttpResponseReader::park_body_consumer.
+        bool park_until_body_available();
 
         int fd() const noexcept
         {
@@ -179,6 +310,11 @@ namespace http
             return peer_status & ConnectionStatus::READING;
         }
 
+        bool has_pending_input() const noexcept
+        {
+            return input_pending;
+        }
+
         const CurrentRequest &get_current_request() const noexcept
         {
             return current_request;
@@ -86,6 +86,13 @@ namespace http
                 : std::runtime_error("HTTP: Invalid chunked encoding" + (message.empty() ? "" : "\n" + message)) {}
         };
 
+        class InvalidContentEncoding : public std::runtime_error
+        {
+        public:
+            InvalidContentEncoding(const std::string &message = "")
+                : std::runtime_error("HTTP: Invalid content encoding" + (message.empty() ? "" : "\n" + message)) {}
+        };
+
         class VersionNotSupported : public std::runtime_error
         {
         public:
@@ -100,11 +107,11 @@ namespace http
                 : std::runtime_error("HTTP: Payload too large" + (message.empty() ? "" : "\n" + message)) {}
         };
 
-        class StatusLineTooLong : public std::runtime_error
+        class ResponseHeadTooLarge : public std::runtime_error
         {
         public:
-            StatusLineTooLong(const std::string &message = "")
-                : std::runtime_error("HTTP: Status line too long" + (message.empty() ? "" : "\n" + message)) {}
+            ResponseHeadTooLarge(const std::string &message = "")
+                : std::runtime_error("HTTP: Response head too large" + (message.empty() ? "" : "\n" + message)) {}
         };
     }
 }
@@ -3,30 +3,29 @@
 
 #include "http/http.hpp"
 #include "http_connection.hpp"
+#include "connection_pool.hpp"
+#include "buffer_pool.hpp"
+#include "response_header_cache.hpp"
+#include "response_compression.hpp"
+#include "response_cache.hpp"
+#include "request_coalescer.hpp"
+#include "static_files_watch.hpp"
 #include "event_manager.hpp"
+#include "body_producer.hpp"
 #include "logger.hpp"
 
-#include <map>
-#include <unordered_map>
+#include <memory>
 #include <queue>
 #include <string>
 #include <functional>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <algorithm>
+#include <atomic>
 
 namespace http
 {
-    namespace sizes
-    {
-        /// Maximum accepted request-line size before request is rejected.
-        const size_t MAX_REQUEST_LINE_SIZE = 8192; // 8 KB
-        /// Maximum accepted aggregate header bytes.
-        const size_t MAX_HEADER_SIZE = 8192;
-        /// Per-connection socket read buffer size.
-        const size_t READ_BUFFER_SIZE = 8192;
-    }
-
     /// Private runtime state for HttpServer.
     /// Owns sockets, event managers, connection maps, and worker coordination queues.
     struct HttpServer::Impl
@@ -36,40 +35,100 @@ namespace http
         tcp::EventManager response_event_manager;
         HttpServerConfig config;
         RequestHandler request_handler;
-        // fd -> active connection state.
-        std::map<int, HttpConnection> connections;
-        // active-connection pointer -> fd (reverse index for O(1) cleanup lookup).
-        std::unordered_map<HttpConnection *, int> connection_ids;
-        // event-manager id -> connection currently scheduled for response writes.
-        std::map<int, HttpConnection *> response_sending_connections;
+        // I/O buffers lent to connections while they read or write, declared before connections which borrow from it.
+        BufferPool buffer_pool;
+        // Date and Server lines of every response head, the event loop refreshes the date.
+        ResponseHeaderCache header_cache;
+        // Keys and shareability of responses for response_cache and request_coalescer.
+        ResponseSharing response_sharing;
+        // Handler responses answered without the handler, null unless response_cache is set.
+        std::unique_ptr<ResponseCache> response_cache;
+        // Identical requests in flight, null unless request_coalescing is set.
+        std::unique_ptr<RequestCoalescer> request_coalescer;
+        // Static files whose cache is invalidated by the event loop, see HttpServer::watch_static_files.
+        // Each is registered with request_event_manager, its address is the event token.
+        std::vector<std::unique_ptr<StaticFiles>> watched_static_files;
+        // Set when the event loop starts; watched_static_files is only read by it from then on and must no longer change.
+        std::atomic<bool> started{false};
+        // Slab of connection objects, one slot per allowed concurrent connection.
+        ConnectionPool connections;
+        // Number of unfinished connections registered in response_event_manager, guarded by response_mutex.
+        size_t response_sending_count = 0;
+
+        // False while the connection limit is reached and the listening socket is not polled.
+        bool accepting_connections = true;
+        // Reused accept array, its capacity is reserved once so accepting does not allocate.
+        std::vector<tcp::ConnectionSocket> accepted_sockets;
+        // Connections whose last read stopped at the I/O quantum, served again on the next iteration.
+        std::vector<HttpConnection *> pending_input_connections;
+        // Swap partner of pending_input_connections while the pending ones are being served.
+        std::vector<HttpConnection *> serving_input_connections;
 
         // connections ready to run request handler logic.
         std::queue<HttpConnection *> waiting_for_handler_connections;
-        // connections with responses ready for the response thread.
-        std::queue<HttpConnection *> waiting_to_send_response;
 
         std::mutex completed_connections_mutex;
         // connections finished or failed and pending cleanup in event loop thread.
-        std::queue<HttpConnection *> completed_connections;
+        // Handles make a connection queued twice harmless once its slot was recycled.
+        std::queue<ConnectionHandle> completed_connections;
 
         std::mutex handler_mutex;
         std::vector<std::thread> handler_threads;
         std::condition_variable handler_cv;
 
+        std::mutex body_producer_mutex;
+        std::vector<std::thread> body_producer_threads;
+        std::condition_variable body_producer_cv;
+        // Generators ready to run, a paused one is queued again once its response drained enough.
+        std::queue<std::shared_ptr<BodyProducer>> waiting_body_producers;
+
         std::mutex response_mutex;
         std::thread response_thread;
         std::condition_variable response_cv;
 
         /// Spawns worker threads that consume waiting_for_handler_connections.
         void initialize_handler_threads();
-        /// Spawns response thread that consumes waiting_to_send_response.
+        /// Spawns worker threads that run response body generators from waiting_body_producers.
+        void initialize_body_producer_threads();
+        /// Spawns response thread that finishes responses whose sockets were full when first sent.
         void initialize_response_thread();
 
         /// Main accept/poll/dispatch loop.
         void start_event_loop();
-        /// Accepts new TCP peers and inserts them into connection/event maps.
+        /// Accepts up to max_accepts_per_iteration new TCP peers and inserts them into connection/event maps.
         void accept_new_connections();
-        /// Marks connections inactive when idle timeout is exceeded.
+        /// Reads and parses request head bytes of a readable connection and dispatches it once complete.
+        void process_connection_input(HttpConnection &connection);
+        /// Stops polling the listening socket; new peers wait in the kernel backlog.
+        void pause_accepting();
+        /// Resumes polling the listening socket once a connection slot is free again.
+        void resume_accepting();
+        /// @return Total connection slots, including the ones reserved for reserved_connection_sources.
+        size_t connection_limit() const noexcept;
+        /// @return True if a peer with this ip may use a reserved connection slot.
+        bool is_reserved_source(const std::string &ip) const;
+        /// Sends as much of the response as the socket takes; unfinished connections are armed for one write event
+        /// that the response thread handles. Called by whichever thread currently owns the connection.
+        /// @return True once the connection is done and queued for cleanup.
+        bool send_response_or_arm(HttpConnection &connection);
+        /// Arms the connection for one write event handled by the response thread.
+        /// @return False if the socket could not be armed; the connection is then marked inactive.
+        bool arm_for_write(HttpConnection &connection);
+        /// Ends the flight a handled request leads: parked identical requests get its response, or run the handler themselves
+        /// if it can not be shared. Called by the handler thread of the leader.
+        void finish_flight(HttpConnection &leader);
+        /// Queues a finished or failed response for cleanup in the event loop.
+        void finish_response(HttpConnection &connection);
+        /// Queues the connection for closing and slot release in the event loop.
+        void queue_completed(HttpConnection &connection);
+        /// Hands a generator body of a handled request to the body producer threads.
+        void start_body_producer(HttpConnection &connection);
+        /// Queues a body producer to run on a body producer thread.
+        void schedule_body_producer(std::shared_ptr<BodyProducer> producer);
+        /// Applies the file changes reported for a watched StaticFiles.
+        /// @return False if token does not belong to one of watched_static_files.
+        bool apply_file_changes(void *token);
+        /// Marks connections inactive when idle timeout is exceeded, and queues the ones still reading their head for cleanup.
         void mark_inactive_connections();
         /// Removes and closes connections queued in completed_connections.
         void remove_completed_connections();
@@ -88,7 +147,29 @@ namespace http
              RequestHandler handler) : server_socket(std::move(sock)),
                                        request_event_manager(std::move(req_em)),
                                        response_event_manager(std::move(resp_em)),
-                                       config(_config), request_handler(handler) {}
+                                       config(_config), request_handler(handler),
+                                       buffer_pool(_config.io_buffer_size,
+                                                   _config.io_buffer_pool_blocks != 0 ? _config.io_buffer_pool_blocks : static_cast<size_t>(_config.max_concurrent_connections) + _config.reserved_connections,
+                                                   // A request head must fit into one buffer.
+                                                   std::max(_config.io_buffer_max_size, _config.max_request_line_size + _config.max_header_size),
+                                                   _config.io_buffer_huge_pages),
+                                       header_cache(_config.server_header),
+                                       response_sharing(_config.response_cache_vary_headers),
+                                       connections(static_cast<size_t>(_config.max_concurrent_connections) + _config.reserved_connections, buffer_pool, config, header_cache)
+        {
+            if ((config.compression || config.request_decompression) && config.compression_codecs.empty())
+            {
+                config.compression_codecs = ResponseCompression::builtin_codecs();
+            }
+            if (config.response_cache)
+            {
+                response_cache.reset(new ResponseCache(config.response_cache_size, response_sharing));
+            }
+            if (config.request_coalescing)
+            {
+                request_coalescer.reset(new RequestCoalescer());
+            }
+        }
     };
 }
 #endif // HTTP_INTERNAL_HPP
\ No newline at end of file
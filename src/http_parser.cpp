@@ -1,5 +1,6 @@
 #include "http_parser.hpp"
 #include "http_exceptions.hpp"
+#include "response_header_cache.hpp"
 
 #include "http/http_request.hpp"
 #include "http/http_response.hpp"
@@ -11,6 +12,8 @@
 #include <stdexcept>
 #include <cstring>
 #include <cstdint>
+#include <cstdio>
+#include <vector>
 
 namespace
 {
@@ -25,6 +28,179 @@ namespace
         http::headers::IF_MATCH,
         http::headers::IF_NONE_MATCH,
     };
+
+    /// Preformatted HTTP/1.1 status line of a standard status code.
+    struct StatusLine
+    {
+        const char *reason = nullptr;
+        /// "HTTP/1.1 <code> <reason>\r\n"
+        std::string line;
+        /// The status line followed by the headers every server-generated error carries.
+        std::string error_head;
+    };
+
+    const int MIN_STATUS_CODE = 100;
+    const int MAX_STATUS_CODE = 599;
+
+    const std::vector<StatusLine> &status_lines()
+    {
+        static const std::vector<StatusLine> table = []()
+        {
+            const std::pair<int, const char *> reasons[] = {
+                {100, "Continue"},
+                {101, "Switching Protocols"},
+                {102, "Processing"},
+                {103, "Early Hints"},
+                {200, "OK"},
+                {201, "Created"},
+                {202, "Accepted"},
+                {203, "Non-Authoritative Information"},
+                {204, "No Content"},
+                {205, "Reset Content"},
+                {206, "Partial Content"},
+                {207, "Multi-Status"},
+                {208, "Already Reported"},
+                {226, "IM Used"},
+                {300, "Multiple Choices"},
+                {301, "Moved Permanently"},
+                {302, "Found"},
+                {303, "See Other"},
+                {304, "Not Modified"},
+                {305, "Use Proxy"},
+                {307, "Temporary Redirect"},
+                {308, "Permanent Redirect"},
+                {400, "Bad Request"},
+                {401, "Unauthorized"},
+                {402, "Payment Required"},
+                {403, "Forbidden"},
+                {404, "Not Found"},
+                {405, "Method Not Allowed"},
+                {406, "Not Acceptable"},
+                {407, "Proxy Authentication Required"},
+                {408, "Request Timeout"},
+                {409, "Conflict"},
+                {410, "Gone"},
+                {411, "Length Required"},
+                {412, "Precondition Failed"},
+                {413, "Payload Too Large"},
+                {414, "URI Too Long"},
+                {415, "Unsupported Media Type"},
+                {416, "Range Not Satisfiable"},
+                {417, "Expectation Failed"},
+                {421, "Misdirected Request"},
+                {422, "Unprocessable Content"},
+                {423, "Locked"},
+                {424, "Failed Dependency"},
+                {425, "Too Early"},
+                {426, "Upgrade Required"},
+                {428, "Precondition Required"},
+                {429, "Too Many Requests"},
+                {431, "Request Header Fields Too Large"},
+                {451, "Unavailable For Legal Reasons"},
+                {500, "Internal Server Error"},
+                {501, "Not Implemented"},
+                {502, "Bad Gateway"},
+                {503, "Service Unavailable"},
+                {504, "Gateway Timeout"},
+                {505, "HTTP Version Not Supported"},
+                {506, "Variant Also Negotiates"},
+                {507, "Insufficient Storage"},
+                {508, "Loop Detected"},
+                {510, "Not Extended"},
+                {511, "Network Authentication Required"},
+            };
+
+            std::vector<StatusLine> lines(MAX_STATUS_CODE - MIN_STATUS_CODE + 1);
+            for (const auto &reason : reasons)
+            {
+                StatusLine &entry = lines[reason.first - MIN_STATUS_CODE];
+                entry.reason = reason.second;
+                entry.line = http::versions::HTTP_1_1 + " " + std::to_string(reason.first) + " " + reason.second + "\r\n";
+                entry.error_head = entry.line + http::headers::CONNECTION + ":close\r\n" + http::headers::CONTENT_LENGTH + ":0\r\n\r\n";
+            }
+            return lines;
+        }();
+        return table;
+    }
+
+    const StatusLine *find_status_line(int status_code)
+    {
+        if (status_code < MIN_STATUS_CODE || status_code > MAX_STATUS_CODE)
+        {
+            return nullptr;
+        }
+        const StatusLine &line = status_lines()[status_code - MIN_STATUS_CODE];
+        return line.reason ? &line : nullptr;
+    }
+
+    /// The table entry if the response can use it verbatim, nullptr if its status line has to be formatted.
+    const StatusLine *find_standard_status_line(const http::HttpResponse &response)
+    {
+        const StatusLine *line = find_status_line(response.status_code());
+        if (!line || response.version() != http::versions::HTTP_1_1 || response.reason_phrase() != line->reason)
+        {
+            return nullptr;
+        }
+        return line;
+    }
+
+    /// Date and Server lines taken from the header cache, unless the response sets its own.
+    struct CachedLines
+    {
+        const http::ResponseHeaderCache *header_cache = nullptr;
+        bool date = false;
+        bool server = false;
+
+        CachedLines(const http::ResponseHeaderCache *header_cache, bool add_date, bool add_server)
+            : header_cache(header_cache), date(header_cache && add_date), server(header_cache && add_server && !header_cache->get_server_line().empty()) {}
+
+        CachedLines(const http::HttpResponse &response, const http::ResponseHeaderCache *header_cache) : header_cache(header_cache)
+        {
+            if (header_cache)
+            {
+                const auto &headers = response.headers();
+                date = headers.empty() || headers.find(http::headers::DATE) == headers.end();
+                server = !header_cache->get_server_line().empty() && (headers.empty() || headers.find(http::headers::SERVER) == headers.end());
+            }
+        }
+
+        size_t size() const noexcept
+        {
+            return (date ? header_cache->date_line_size() : 0) + (server ? header_cache->get_server_line().size() : 0);
+        }
+
+        char *write(char *out) const noexcept
+        {
+            if (date)
+            {
+                header_cache->write_date_line(out);
+                out += header_cache->date_line_size();
+            }
+            if (server)
+            {
+                memcpy(out, header_cache->get_server_line().data(), header_cache->get_server_line().size());
+                out += header_cache->get_server_line().size();
+            }
+            return out;
+        }
+    };
+
+    size_t head_size(const http::HttpResponse &response, const StatusLine *standard_line, const CachedLines &cached_lines)
+    {
+        // status-line header:value\r\n ... \r\n
+        size_t size = 2 + cached_lines.size();
+        for (const auto &header : response.headers())
+        {
+            size += header.first.size() + header.second.size() + 3; // ':' + "\r\n"
+        }
+        if (standard_line)
+        {
+            return size + standard_line->line.size();
+        }
+        char digits[16];
+        int digit_count = snprintf(digits, sizeof(digits), "%d", response.status_code());
+        return size + response.version().size() + response.reason_phrase().size() + static_cast<size_t>(digit_count) + 4; // 2 spaces + "\r\n"
+    }
 }
 
 bool http::HttpParser::has_transfer_encoding_chunked_header(const std::unordered_map<std::string, std::string> &headers)
@@ -88,7 +264,7 @@ int64_t http::HttpParser::has_content_length_header(const std::unordered_map<std
     return -1;
 }
 
-http::HttpRequestLine http::HttpParser::parse_request_line(const std::vector<char> &raw_request, size_t cursor)
+http::HttpRequestLine http::HttpParser::parse_request_line(const IoBuffer &raw_request, size_t cursor)
 {
     http::HttpRequestLine request_line;
     size_t start = cursor;
@@ -121,7 +297,7 @@ http::HttpRequestLine http::HttpParser::parse_request_line(const std::vector<cha
     return request_line;
 }
 
-std::unordered_map<std::string, std::string> http::HttpParser::parse_headers(const std::vector<char> &raw_request, size_t cursor)
+std::unordered_map<std::string, std::string> http::HttpParser::parse_headers(const IoBuffer &raw_request, size_t cursor)
 {
     std::unordered_map<std::string, std::string> headers;
     while (cursor < raw_request.size())
@@ -174,7 +350,7 @@ std::unordered_map<std::string, std::string> http::HttpParser::parse_headers(con
     return headers;
 }
 
-bool http::HttpParser::validate_request_line(const std::vector<char> &request_line_byte_buffer)
+bool http::HttpParser::validate_request_line(const IoBuffer &request_line_byte_buffer)
 {
     // Method SP Request-URI SP HTTP-Version CRLF
     // SP count should be 2 in a valid request line
@@ -193,56 +369,113 @@ bool http::HttpParser::validate_request_line(const std::vector<char> &request_li
     return space_count == 2;
 }
 
-size_t http::HttpParser::encode_response_status_line(const std::string &version, int status_code, const std::string &reason_phrase, std::vector<char> &buffer, size_t cursor)
+size_t http::HttpParser::response_head_size(const HttpResponse &response, const ResponseHeaderCache *header_cache)
 {
-    // version status-code reason_phrase\r\n
-    std::string status_line = version + " " + std::to_string(status_code) + " " + reason_phrase + "\r\n";
-    if (status_line.size() + cursor > buffer.size())
+    return head_size(response, find_standard_status_line(response), CachedLines(response, header_cache));
+}
+
+size_t http::HttpParser::encode_response_head(const HttpResponse &response, const ResponseHeaderCache *header_cache, IoBuffer &buffer, size_t cursor)
+{
+    const StatusLine *standard_line = find_standard_status_line(response);
+    const CachedLines cached_lines(response, header_cache);
+    const size_t required_size = head_size(response, standard_line, cached_lines);
+    if (cursor + required_size > buffer.size())
     {
         return 0;
     }
 
-    memcpy(buffer.data() + cursor, status_line.data(), status_line.size());
-    return status_line.size();
+    char *out = buffer.data() + cursor;
+    if (standard_line)
+    {
+        memcpy(out, standard_line->line.data(), standard_line->line.size());
+        out += standard_line->line.size();
+    }
+    else
+    {
+        // version status-code reason_phrase\r\n
+        char digits[16];
+        int digit_count = snprintf(digits, sizeof(digits), "%d", response.status_code());
+        memcpy(out, response.version().data(), response.version().size());
+        out += response.version().size();
+        *out++ = ' ';
+        memcpy(out, digits, digit_count);
+        out += digit_count;
+        *out++ = ' ';
+        memcpy(out, response.reason_phrase().data(), response.reason_phrase().size());
+        out += response.reason_phrase().size();
+        *out++ = '\r';
+        *out++ = '\n';
+    }
+
+    out = cached_lines.write(out);
+    for (const auto &header : response.headers())
+    {
+        memcpy(out, header.first.data(), header.first.size());
+        out += header.first.size();
+        *out++ = ':';
+        memcpy(out, header.second.data(), header.second.size());
+        out += header.second.size();
+        *out++ = '\r';
+        *out++ = '\n';
+    }
+    *out++ = '\r';
+    *out++ = '\n';
+
+    return required_size;
 }
 
-size_t http::HttpParser::encode_response_header(const std::string &header, const std::string &value, std::vector<char> &buffer, size_t cursor)
+const std::string *http::HttpParser::preformatted_error_head(int status_code, const std::string &reason_phrase)
 {
-    // header:value\r\n
-    const size_t required_size = header.size() + value.size() + 3; // ':' + "\r\n"
-    if (cursor + required_size > buffer.size())
+    const StatusLine *line = find_status_line(status_code);
+    if (!line || reason_phrase != line->reason)
     {
-        return 0;
+        return nullptr;
     }
+    return &line->error_head;
+}
 
-    memcpy(buffer.data() + cursor, header.data(), header.size());
-    cursor += header.size();
+size_t http::HttpParser::cached_lines_size(const ResponseHeaderCache *header_cache, bool add_date, bool add_server)
+{
+    return CachedLines(header_cache, add_date, add_server).size();
+}
 
-    buffer[cursor++] = ':';
-    memcpy(buffer.data() + cursor, value.data(), value.size());
-    cursor += value.size();
+size_t http::HttpParser::encode_status_line(const char *status_line, size_t status_line_size, const ResponseHeaderCache *header_cache, bool add_date, bool add_server, IoBuffer &buffer, size_t cursor)
+{
+    const CachedLines cached_lines(header_cache, add_date, add_server);
+    const size_t required_size = status_line_size + cached_lines.size();
+    if (cursor + required_size > buffer.size())
+    {
+        return 0;
+    }
 
-    buffer[cursor++] = '\r';
-    buffer[cursor++] = '\n';
+    char *out = buffer.data() + cursor;
+    memcpy(out, status_line, status_line_size);
+    cached_lines.write(out + status_line_size);
 
     return required_size;
 }
 
-size_t http::HttpParser::encode_end_of_headers(std::vector<char> &buffer, size_t cursor)
+size_t http::HttpParser::preformatted_head_size(const std::string &head, const ResponseHeaderCache *header_cache)
 {
-    // \r\n
-    if (cursor + 2 > buffer.size())
+    return head.size() + CachedLines(header_cache, true, true).size();
+}
+
+size_t http::HttpParser::encode_preformatted_head(const std::string &head, const ResponseHeaderCache *header_cache, IoBuffer &buffer, size_t cursor)
+{
+    if (cursor + preformatted_head_size(head, header_cache) > buffer.size())
     {
         return 0;
     }
 
-    buffer[cursor++] = '\r';
-    buffer[cursor++] = '\n';
+    // The cached lines go right after the status line.
+    size_t line_size = head.find('\n') + 1;
+    size_t bytes_written = encode_status_line(head.data(), line_size, header_cache, true, true, buffer, cursor);
+    memcpy(buffer.data() + cursor + bytes_written, head.data() + line_size, head.size() - line_size);
 
-    return 2;
+    return bytes_written + head.size() - line_size;
 }
 
-size_t http::HttpParser::encode_chunksize_line(size_t chunk_size, unsigned int width, std::vector<char> &buffer, size_t cursor)
+size_t http::HttpParser::encode_chunksize_line(size_t chunk_size, unsigned int width, IoBuffer &buffer, size_t cursor)
 {
     // XXXX\r\n X = Hex digit.
     size_t digits = width;
@@ -275,7 +508,18 @@ size_t http::HttpParser::encode_chunksize_line(size_t chunk_size, unsigned int w
     return digits + 2;
 }
 
-size_t http::HttpParser::encode_chunk_end(std::vector<char> &buffer, size_t cursor)
+unsigned int http::HttpParser::chunksize_width(size_t max_chunk_size)
+{
+    unsigned int width = 1;
+    while (max_chunk_size >= 16)
+    {
+        max_chunk_size /= 16;
+        ++width;
+    }
+    return width;
+}
+
+size_t http::HttpParser::encode_chunk_end(IoBuffer &buffer, size_t cursor)
 {
     // \r\n
     if (cursor + 2 > buffer.size())
@@ -4,6 +4,8 @@
 #ifndef HTTP_PARSER
 #define HTTP_PARSER
 
+#include "buffer_pool.hpp"
+
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -12,6 +14,9 @@
 
 namespace http
 {
+    class HttpResponse;
+    class ResponseHeaderCache;
+
     /// @brief Struct representing the components of an HTTP request line.
     struct HttpRequestLine
     {
@@ -30,22 +35,22 @@ namespace http
     {
     public:
         /// @brief Parses the request line from the raw HTTP request
-        /// @param raw_request vector of chars representing the raw HTTP request.
+        /// @param raw_request buffer holding the raw HTTP request.
         /// @param cursor Starting position for parsing.
         /// @return Returns an HttpRequestLine struct containing method, uri, and version.
         /// Parsing stops at CRLF for the request line.
-        static HttpRequestLine parse_request_line(const std::vector<char> &raw_request, size_t cursor = 0);
+        static HttpRequestLine parse_request_line(const IoBuffer &raw_request, size_t cursor = 0);
 
         /// @brief Parses the headers from the raw HTTP request
-        /// @param raw_request vector of chars representing the raw HTTP request.
+        /// @param raw_request buffer holding the raw HTTP request.
         /// @param cursor Starting position for parsing.
         /// @return Returns a map of header key-value pairs. Header names are normalized to lowercase.
-        static std::unordered_map<std::string, std::string> parse_headers(const std::vector<char> &raw_request, size_t cursor = 0);
+        static std::unordered_map<std::string, std::string> parse_headers(const IoBuffer &raw_request, size_t cursor = 0);
 
         /// @brief Validates the request line format.
-        /// @param request_line_byte_buffer vector of chars representing the request line.
+        /// @param request_line_byte_buffer buffer holding the request line.
         /// @return Returns true if the request line is valid, false otherwise.
-        static bool validate_request_line(const std::vector<char> &request_line_byte_buffer);
+        static bool validate_request_line(const IoBuffer &request_line_byte_buffer);
 
         /// @brief Checks if the header list contains a Content-Length header and returns its value if present.
         /// @param headers unordered_map of header key-value pairs.
@@ -57,42 +62,71 @@ namespace http
         /// @return Returns true only if the final Transfer-Encoding token is "chunked".
         static bool has_transfer_encoding_chunked_header(const std::unordered_map<std::string, std::string> &headers);
 
-        /// @brief Encodes the response status line into the buffer.
-        /// @param version Http version string (e.g., "HTTP/1.1").
-        /// @param status_code Status code for the response (e.g., 200, 404).
-        /// @param reason_phrase Reason phrase (e.g., "OK", "Not Found").
-        /// @param buffer Vector of chars to which the encoded status line will be appended.
-        /// @param cursor Position in the buffer where the encoded status line should be written. Defaults to 0.
-        /// @return No of bytes written to the buffer.
-        static size_t encode_response_status_line(const std::string &version, int status_code, const std::string &reason_phrase, std::vector<char> &buffer, size_t cursor = 0);
-
-        /// @brief Encodes a single header line into the buffer.
-        /// @param header Header name (e.g., "Content-Type").
-        /// @param value Header value (e.g., "text/html").
-        /// @param buffer Vector of chars to which the encoded header will be appended.
-        /// @param cursor Position in the buffer where the encoded header should be written. Defaults to 0.
-        /// @return Number of bytes written to the buffer.
-        static size_t encode_response_header(const std::string &header, const std::string &value, std::vector<char> &buffer, size_t cursor = 0);
+        /// @brief Computes the exact size of the serialized response head: status line, headers and the empty line.
+        /// @param response Response whose head is measured.
+        /// @param header_cache Source of the Date and Server lines, nullptr to add none.
+        /// @return Number of bytes encode_response_head() writes for the response.
+        static size_t response_head_size(const HttpResponse &response, const ResponseHeaderCache *header_cache = nullptr);
 
-        /// @brief Encodes the end of headers marker into the buffer.
-        /// @param buffer Vector of chars to which the marker will be appended.
-        /// @param cursor Position in the buffer where the marker should be written. Defaults to 0.
-        /// @return Number of bytes written to the buffer.
-        static size_t encode_end_of_headers(std::vector<char> &buffer, size_t cursor = 0);
+        /// @brief Encodes the complete response head into the buffer in a single pass.
+        /// Standard status codes with their usual reason phrase are copied from a preformatted status line table.
+        /// @param response Response whose status line and headers are written.
+        /// @param header_cache Source of the Date and Server lines, nullptr to add none. Headers set on the response take precedence.
+        /// @param buffer Buffer to which the head will be appended.
+        /// @param cursor Position in the buffer where the head should be written. Defaults to 0.
+        /// @return Number of bytes written to the buffer, 0 if the whole head does not fit.
+        static size_t encode_response_head(const HttpResponse &response, const ResponseHeaderCache *header_cache, IoBuffer &buffer, size_t cursor = 0);
+
+        /// @brief Looks up the constant head of a server-generated error response.
+        /// The head carries the status line, "connection: close" and "content-length: 0".
+        /// @param status_code Status code of the response.
+        /// @param reason_phrase Reason phrase of the response.
+        /// @return The preformatted head, or nullptr if the code is not standard or the reason phrase differs from the standard one.
+        static const std::string *preformatted_error_head(int status_code, const std::string &reason_phrase);
+
+        /// @brief Computes the size of the Date and Server lines encode_status_line() adds.
+        static size_t cached_lines_size(const ResponseHeaderCache *header_cache, bool add_date, bool add_server);
+
+        /// @brief Encodes a preserialized status line followed by the Date and Server lines.
+        /// @param status_line Status line including its CRLF.
+        /// @param status_line_size Bytes of the status line.
+        /// @param header_cache Source of the Date and Server lines, nullptr to add none.
+        /// @param add_date False if the response carries its own Date header.
+        /// @param add_server False if the response carries its own Server header.
+        /// @param buffer Buffer to which the lines will be appended.
+        /// @param cursor Position in the buffer where the lines should be written. Defaults to 0.
+        /// @return Number of bytes written to the buffer, 0 if they do not fit.
+        static size_t encode_status_line(const char *status_line, size_t status_line_size, const ResponseHeaderCache *header_cache, bool add_date, bool add_server, IoBuffer &buffer, size_t cursor = 0);
+
+        /// @brief Computes the size encode_preformatted_head() writes.
+        static size_t preformatted_head_size(const std::string &head, const ResponseHeaderCache *header_cache = nullptr);
+
+        /// @brief Encodes a head returned by preformatted_error_head(), with the Date and Server lines after its status line.
+        /// @param head Preformatted head.
+        /// @param header_cache Source of the Date and Server lines, nullptr to add none.
+        /// @param buffer Buffer to which the head will be appended.
+        /// @param cursor Position in the buffer where the head should be written. Defaults to 0.
+        /// @return Number of bytes written to the buffer, 0 if the whole head does not fit.
+        static size_t encode_preformatted_head(const std::string &head, const ResponseHeaderCache *header_cache, IoBuffer &buffer, size_t cursor = 0);
 
         /// @brief Encodes a chunk size line into the buffer.
         /// @param chunk_size Size of the chunk as non-negative decimal integer.
         /// @param width Width of the chunk size when converted to hexadecimal.
-        /// @param buffer Vector of chars to which the encoded line will be appended.
+        /// @param buffer Buffer to which the encoded line will be appended.
         /// @param cursor Position in the buffer where the encoded line should be written. Defaults to 0.
         /// @return Number of bytes written to the buffer.
-        static size_t encode_chunksize_line(size_t chunk_size, unsigned int width, std::vector<char> &buffer, size_t cursor = 0);
+        static size_t encode_chunksize_line(size_t chunk_size, unsigned int width, IoBuffer &buffer, size_t cursor = 0);
+
+        /// @brief Computes the number of hex digits needed for a chunk size.
+        /// @param max_chunk_size Largest chunk size the line has to hold.
+        /// @return Number of hex digits, at least 1.
+        static unsigned int chunksize_width(size_t max_chunk_size);
 
         /// @brief Encodes the end of a chunk into the buffer.
-        /// @param buffer Vector of chars to which the marker will be appended.
+        /// @param buffer Buffer to which the marker will be appended.
         /// @param cursor Position in the buffer where the marker should be written. Defaults to 0.
         /// @return Number of bytes written to the buffer.
-        static size_t encode_chunk_end(std::vector<char> &buffer, size_t cursor = 0);
+        static size_t encode_chunk_end(IoBuffer &buffer, size_t cursor = 0);
     };
 }
 
@@ -58,6 +58,17 @@ namespace http
         return HttpRequest();
     }
 
+    void HttpRequestBuilder::reset(HttpRequest &request)
+    {
+        request._ip.clear();
+        request._port.clear();
+        request._method.clear();
+        request._uri.clear();
+        request._version.clear();
+        request._headers.clear();
+        request._body.pimpl->data_stream = DataStream();
+    }
+
     HttpRequest::HttpRequest(HttpRequest &&other) noexcept
         : _ip(std::move(other._ip)),
           _port(std::move(other._port)),
@@ -15,6 +15,9 @@ namespace http
         /// @return HttpRequest object with empty fields and an empty body stream.
         static HttpRequest build();
 
+        /// @brief Returns a request to the state produced by build(), keeping string and header storage for reuse.
+        static void reset(HttpRequest &request);
+
         static void set_ip(HttpRequest &request, const std::string &ip);
         static void set_port(HttpRequest &request, const std::string &port);
         static void set_method(HttpRequest &request, const std::string &method);
@@ -4,15 +4,27 @@
 #include "http_response_reader.hpp"
 #include "http_response_builder.hpp"
 #include "data_stream.hpp"
+#include "body_producer.hpp"
+#include "http_parser.hpp"
+#include "file.hpp"
+#include "byte_ranges.hpp"
 
 #include <vector>
+#include <memory>
 #include <stdexcept>
 #include <cstring>
 #include <utility>
 #include <cstdint>
+#include <algorithm>
 
 namespace http
 {
+    namespace
+    {
+        // Bytes a body generator is asked for per call.
+        const size_t GENERATOR_CHUNK_SIZE = 8192;
+    }
+
     struct HttpResponse::Impl
     {
         struct ResponseBodyStream
@@ -33,12 +45,53 @@ namespace http
 
             ~ResponseBodyStream();
 
+            /// Drops the body source, keeping the stream allocations.
+            void reset();
+
+            friend class HttpResponse;
             friend struct HttpResponseReader;
+            friend struct HttpResponseBuilder;
         };
 
         ResponseBodyStream body_stream;
+
+        /// Constant head of an untouched server-generated error response, cleared by every setter.
+        const std::string *preformatted_head = nullptr;
+
+        /// Set by set_snapshot, replaces the status line, headers and body when sending.
+        HttpResponseSnapshot snapshot;
+
+        /// Set by HttpResponseBuilder::set_body_file, sent from the file instead of body_stream.
+        FileRegion file_body;
+        /// Parts of file_body that are sent, the whole region unless HttpResponseBuilder::select_body_parts narrowed it.
+        std::vector<BodyPart> file_parts;
+    };
+
+    struct HttpResponseSnapshot::Impl
+    {
+        int status_code = 0;
+        std::string reason_phrase;
+        /// Status line, headers, empty line and body.
+        std::vector<char> bytes;
+        size_t status_line_size = 0;
+        /// Offset of the body in bytes.
+        size_t body_offset = 0;
+        bool has_date_header = false;
+        bool has_server_header = false;
+        /// Headers as set on the frozen response, for responses sending only a part of the body.
+        std::unordered_map<std::string, std::string> headers;
     };
 
+    HttpResponseSnapshot::HttpResponseSnapshot() = default;
+
+    HttpResponseSnapshot::HttpResponseSnapshot(std::shared_ptr<const Impl> impl) : pimpl(std::move(impl)) {}
+
+    HttpResponseSnapshot::operator bool() const noexcept { return pimpl != nullptr; }
+
+    int HttpResponseSnapshot::status_code() const noexcept { return pimpl ? pimpl->status_code : 0; }
+
+    size_t HttpResponseSnapshot::size() const noexcept { return pimpl ? pimpl->bytes.size() : 0; }
+
     HttpResponse::HttpResponse() : _version(http::versions::HTTP_1_1), _status_code(0), _reason_phrase(""), pimpl(new Impl()) {}
 
     HttpResponse::HttpResponse(int status_code, const std::string &reason_phrase)
@@ -83,12 +136,30 @@ namespace http
 
     const std::unordered_map<std::string, std::string> &HttpResponse::headers() const noexcept { return _headers; }
 
-    void HttpResponse::set_status_code(int status_code) noexcept { _status_code = status_code; }
+    void HttpResponse::set_status_code(int status_code) noexcept
+    {
+        _status_code = status_code;
+        if (pimpl)
+        {
+            pimpl->preformatted_head = nullptr;
+        }
+    }
 
-    void HttpResponse::set_reason_phrase(const std::string &reason_phrase) { _reason_phrase = reason_phrase; }
+    void HttpResponse::set_reason_phrase(const std::string &reason_phrase)
+    {
+        _reason_phrase = reason_phrase;
+        if (pimpl)
+        {
+            pimpl->preformatted_head = nullptr;
+        }
+    }
 
     void HttpResponse::set_header(const std::string &key, const std::string &value)
     {
+        if (pimpl)
+        {
+            pimpl->preformatted_head = nullptr;
+        }
         std::string lower_key = key;
         for (char &c : lower_key)
         {
@@ -100,11 +171,24 @@ namespace http
 
     void HttpResponse::set_body_generator(WriterFunction writer)
     {
+        pimpl->preformatted_head = nullptr;
+        pimpl->file_body = FileRegion();
         pimpl->body_stream = Impl::ResponseBodyStream(writer);
     }
 
+    void HttpResponse::set_status_text(int status_code, const std::string &reason_phrase)
+    {
+        set_status_code(status_code);
+        set_reason_phrase(reason_phrase);
+        set_header(http::headers::CONTENT_TYPE, "text/plain; charset=utf-8");
+        set_header(http::headers::CONTENT_LENGTH, std::to_string(reason_phrase.size()));
+        set_body(std::vector<char>(reason_phrase.begin(), reason_phrase.end()));
+    }
+
     void HttpResponse::set_body(const std::vector<char> &data)
     {
+        pimpl->preformatted_head = nullptr;
+        pimpl->file_body = FileRegion();
         pimpl->body_stream = Impl::ResponseBodyStream(data);
     }
 
@@ -114,41 +198,64 @@ namespace http
 
         DataStream::StreamView current_view;
 
+        // Generator output waiting to be read, allocated on the first generator call.
         std::vector<char> buffer;
         size_t buffer_cursor = 0;
         size_t buffer_size = 0;
         bool is_stream_closed = false;
 
+        // Body passed to set_body, read in place.
+        std::vector<char> body_data;
+        size_t body_cursor = 0;
+
+        // Set by set_stream_parts: the prefixes and selected bytes of the parts, read one segment after the other.
+        struct Segment
+        {
+            const char *data;
+            size_t size;
+        };
+        std::vector<BodyPart> parts;
+        std::vector<Segment> segments;
+        size_t segment_index = 0;
+        size_t segment_cursor = 0;
+        // Keeps the memory the segments point into alive when it is not body_data.
+        std::shared_ptr<const void> segments_owner;
+
+        WriterFunction writer;
+        // True for bodies set through set_body_generator, these may be produced on another thread.
+        bool is_generator = false;
+        // Set once the generator was handed to a BodyProducer, reads then come from its ring.
+        std::shared_ptr<BodyProducer> producer;
+
         void set_stream_functions(WriterFunction writer);
+        void set_stream_data(const std::vector<char> &data);
+        void set_stream_parts(const char *body, std::vector<BodyPart> &&parts, std::shared_ptr<const void> &&owner);
+        void reset();
+
+        ~Impl()
+        {
+            if (producer)
+            {
+                producer->cancel();
+            }
+        }
     };
 
     HttpResponse::Impl::ResponseBodyStream::ResponseBodyStream()
         : pimpl(new Impl())
     {
-        pimpl->buffer.resize(8192); // Placeholder buffer size
     }
 
     HttpResponse::Impl::ResponseBodyStream::ResponseBodyStream(WriterFunction writer)
         : ResponseBodyStream()
     {
         pimpl->set_stream_functions(writer);
+        pimpl->is_generator = true;
     }
 
     HttpResponse::Impl::ResponseBodyStream::ResponseBodyStream(const std::vector<char> &data) : ResponseBodyStream()
     {
-        auto writer =
-            [data, bytes_left = data.size()](std::vector<char> &buffer) mutable -> int64_t
-        {
-            if (bytes_left == 0)
-            {
-                return -1; // Indicate end of stream
-            }
-            size_t chunk_size = std::min(bytes_left, buffer.size());
-            std::memcpy(buffer.data(), data.data() + (data.size() - bytes_left), chunk_size);
-            bytes_left -= chunk_size;
-            return chunk_size;
-        };
-        pimpl->set_stream_functions(writer);
+        pimpl->set_stream_data(data);
     }
 
     HttpResponse::Impl::ResponseBodyStream::ResponseBodyStream(ResponseBodyStream &&other) noexcept
@@ -174,12 +281,44 @@ namespace http
         delete pimpl;
     }
 
+    void HttpResponse::Impl::ResponseBodyStream::reset()
+    {
+        pimpl->reset();
+    }
+
+    void HttpResponse::Impl::ResponseBodyStream::Impl::reset()
+    {
+        if (producer)
+        {
+            producer->cancel();
+            producer.reset();
+        }
+        data_stream = DataStream();
+        writer = nullptr;
+        is_generator = false;
+        buffer_cursor = 0;
+        buffer_size = 0;
+        is_stream_closed = false;
+        body_data.clear();
+        body_cursor = 0;
+        parts.clear();
+        segments.clear();
+        segment_index = 0;
+        segment_cursor = 0;
+        segments_owner.reset();
+    }
+
     void HttpResponse::Impl::ResponseBodyStream::Impl::set_stream_functions(WriterFunction writer)
     {
+        this->writer = std::move(writer);
         this->data_stream.set_stream_updater(
-            [this, writer]()
+            [this]()
             {
-                int64_t bytes_written = writer(this->buffer);
+                if (this->buffer.empty())
+                {
+                    this->buffer.resize(GENERATOR_CHUNK_SIZE);
+                }
+                int64_t bytes_written = this->writer(this->buffer);
                 if (bytes_written == -1)
                 {
                     this->is_stream_closed = true;
@@ -216,6 +355,143 @@ namespace http
             });
     }
 
+    void HttpResponse::Impl::ResponseBodyStream::Impl::set_stream_data(const std::vector<char> &data)
+    {
+        this->body_data = data;
+        this->body_cursor = 0;
+        // Connections copy straight out of body_data, there is nothing to produce.
+        this->data_stream.set_stream_view_provider(
+            [this]()
+            {
+                this->current_view.data = this->body_data.data();
+                this->current_view.size = this->body_data.size();
+                this->current_view.cursor = this->body_cursor;
+                this->current_view.is_closed = this->body_cursor == this->body_data.size();
+                return this->current_view;
+            });
+
+        this->data_stream.set_cursor_advancer(
+            [this](size_t bytes)
+            {
+                this->body_cursor += bytes;
+                if (this->body_cursor > this->body_data.size())
+                {
+                    throw std::overflow_error("ResponseBodyStream: Cursor advanced beyond body size.");
+                }
+            });
+    }
+
+    void HttpResponse::Impl::ResponseBodyStream::Impl::set_stream_parts(const char *body, std::vector<BodyPart> &&parts, std::shared_ptr<const void> &&owner)
+    {
+        this->parts = std::move(parts);
+        this->segments_owner = std::move(owner);
+        this->segments.clear();
+        for (const BodyPart &part : this->parts)
+        {
+            if (!part.prefix.empty())
+            {
+                this->segments.push_back(Segment{part.prefix.data(), part.prefix.size()});
+            }
+            if (part.length != 0)
+            {
+                this->segments.push_back(Segment{body + part.offset, static_cast<size_t>(part.length)});
+            }
+        }
+        this->segment_index = 0;
+        this->segment_cursor = 0;
+        // Only the selected bytes are read, each segment in place.
+        this->data_stream.set_stream_view_provider(
+            [this]()
+            {
+                bool is_closed = this->segment_index == this->segments.size();
+                this->current_view.data = is_closed ? nullptr : const_cast<char *>(this->segments[this->segment_index].data);
+                this->current_view.size = is_closed ? 0 : this->segments[this->segment_index].size;
+                this->current_view.cursor = this->segment_cursor;
+                this->current_view.is_closed = is_closed;
+                return this->current_view;
+            });
+
+        this->data_stream.set_cursor_advancer(
+            [this](size_t bytes)
+            {
+                if (this->segment_index == this->segments.size() || this->segment_cursor + bytes > this->segments[this->segment_index].size)
+                {
+                    throw std::overflow_error("ResponseBodyStream: Cursor advanced beyond body part.");
+                }
+                this->segment_cursor += bytes;
+                if (this->segment_cursor == this->segments[this->segment_index].size)
+                {
+                    ++this->segment_index;
+                    this->segment_cursor = 0;
+                }
+            });
+    }
+
+    HttpResponseSnapshot HttpResponse::freeze() const
+    {
+        if (pimpl->snapshot)
+        {
+            return pimpl->snapshot;
+        }
+
+        const auto &stream = *pimpl->body_stream.pimpl;
+        if (stream.is_generator)
+        {
+            throw std::logic_error("HTTP: A response with a body generator can not be frozen");
+        }
+        if (pimpl->file_body.file)
+        {
+            throw std::logic_error("HTTP: A response with a file body can not be frozen");
+        }
+        if (_headers.find(http::headers::TRANSFER_ENCODING) != _headers.end())
+        {
+            throw std::logic_error("HTTP: A frozen response has a fixed length body, Transfer-Encoding can not be set");
+        }
+
+        // Same headers the connection adds when it sends a regular response.
+        HttpResponse head(_status_code, _reason_phrase);
+        head._headers = _headers;
+        head._headers[http::headers::CONNECTION] = "close";
+        if (_status_code >= 200 && _status_code != 204 && _status_code != 304)
+        {
+            head._headers[http::headers::CONTENT_LENGTH] = std::to_string(stream.body_data.size());
+        }
+
+        auto impl = std::make_shared<HttpResponseSnapshot::Impl>();
+        impl->status_code = _status_code;
+        impl->reason_phrase = _reason_phrase;
+        impl->has_date_header = _headers.find(http::headers::DATE) != _headers.end();
+        impl->has_server_header = _headers.find(http::headers::SERVER) != _headers.end();
+
+        size_t head_size = HttpParser::response_head_size(head);
+        impl->body_offset = head_size;
+        impl->headers = _headers;
+        impl->bytes.resize(head_size + stream.body_data.size());
+        IoBuffer out(impl->bytes.data(), head_size);
+        HttpParser::encode_response_head(head, nullptr, out);
+        if (!stream.body_data.empty())
+        {
+            memcpy(impl->bytes.data() + head_size, stream.body_data.data(), stream.body_data.size());
+        }
+        impl->status_line_size = static_cast<size_t>(std::find(impl->bytes.begin(), impl->bytes.end(), '\n') - impl->bytes.begin()) + 1;
+
+        return HttpResponseSnapshot(std::move(impl));
+    }
+
+    void HttpResponse::set_snapshot(const HttpResponseSnapshot &snapshot)
+    {
+        if (!snapshot)
+        {
+            throw std::invalid_argument("HTTP: Can not send an empty response snapshot");
+        }
+        _status_code = snapshot.pimpl->status_code;
+        _reason_phrase = snapshot.pimpl->reason_phrase;
+        pimpl->preformatted_head = nullptr;
+        pimpl->body_stream.reset();
+        pimpl->file_body = FileRegion();
+        pimpl->snapshot = snapshot;
+    }
+
     HttpResponse HttpResponseBuilder::build()
     {
         return HttpResponse();
@@ -223,15 +499,169 @@ namespace http
 
     HttpResponse HttpResponseBuilder::build(int status_code, const std::string &reason_phrase)
     {
-        return HttpResponse(status_code, reason_phrase);
+        HttpResponse response(status_code, reason_phrase);
+        response.pimpl->preformatted_head = HttpParser::preformatted_error_head(status_code, reason_phrase);
+        return response;
+    }
+
+    void HttpResponseBuilder::reset(HttpResponse &response)
+    {
+        if (!response.pimpl)
+        {
+            response = HttpResponse();
+            return;
+        }
+        response._version = http::versions::HTTP_1_1;
+        response._status_code = 0;
+        response._reason_phrase.clear();
+        response._headers.clear();
+        response.pimpl->body_stream.reset();
+        response.pimpl->preformatted_head = nullptr;
+        response.pimpl->snapshot = HttpResponseSnapshot();
+        response.pimpl->file_body = FileRegion();
+    }
+
+    void HttpResponseBuilder::set_body_file(HttpResponse &response, const FileRegion &region)
+    {
+        response.pimpl->preformatted_head = nullptr;
+        response.pimpl->body_stream.reset();
+        response.pimpl->snapshot = HttpResponseSnapshot();
+        response.pimpl->file_body = region;
+        response.pimpl->file_parts.assign(1, BodyPart());
+        response.pimpl->file_parts[0].length = region.length;
+    }
+
+    void HttpResponseBuilder::select_body_parts(HttpResponse &response, std::vector<BodyPart> parts)
+    {
+        HttpResponse::Impl &impl = *response.pimpl;
+        impl.preformatted_head = nullptr;
+        if (impl.file_body.file)
+        {
+            impl.file_parts = std::move(parts);
+            return;
+        }
+
+        auto &stream = *impl.body_stream.pimpl;
+        if (stream.is_generator)
+        {
+            throw std::logic_error("HTTP: Parts of a generated body can not be selected");
+        }
+        const char *body = stream.body_data.data();
+        std::shared_ptr<const void> owner;
+        if (impl.snapshot)
+        {
+            // The parts are read from the snapshot bytes, its headers are sent as regular ones.
+            std::shared_ptr<const HttpResponseSnapshot::Impl> snapshot = impl.snapshot.pimpl;
+            response._headers = snapshot->headers;
+            body = snapshot->bytes.data() + snapshot->body_offset;
+            owner = snapshot;
+            impl.snapshot = HttpResponseSnapshot();
+        }
+        stream.set_stream_parts(body, std::move(parts), std::move(owner));
     }
 
-    int64_t HttpResponseReader::read_body_stream(const HttpResponse &response, std::vector<char> &buffer, size_t buffer_pointer, size_t max_size)
+    void HttpResponseBuilder::remove_header(HttpResponse &response, const std::string &key)
     {
+        response._headers.erase(key);
+        if (response.pimpl)
+        {
+            response.pimpl->preformatted_head = nullptr;
+        }
+    }
+
+    int64_t HttpResponseReader::read_body_stream(const HttpResponse &response, IoBuffer &buffer, size_t buffer_pointer, size_t max_size)
+    {
+        if (response.pimpl->body_stream.pimpl->producer)
+        {
+            return response.pimpl->body_stream.pimpl->producer->read(buffer.data(), buffer.size(), buffer_pointer, max_size);
+        }
         if (response.pimpl->body_stream.pimpl->data_stream.is_stream_closed())
         {
             return -1; // Indicate end of stream
         }
-        return response.pimpl->body_stream.pimpl->data_stream.get_next(buffer, buffer_pointer, max_size);
+        return response.pimpl->body_stream.pimpl->data_stream.get_next(buffer.data(), buffer.size(), buffer_pointer, max_size);
+    }
+
+    std::shared_ptr<BodyProducer> HttpResponseReader::make_body_producer(const HttpResponse &response, size_t high_watermark, size_t low_watermark)
+    {
+        auto &stream = *response.pimpl->body_stream.pimpl;
+        if (!stream.is_generator || stream.producer)
+        {
+            return nullptr;
+        }
+        stream.producer = std::make_shared<BodyProducer>(std::move(stream.writer), high_watermark, low_watermark, GENERATOR_CHUNK_SIZE);
+        stream.writer = nullptr;
+        return stream.producer;
+    }
+
+    bool HttpResponseReader::has_body_generator(const HttpResponse &response)
+    {
+        return response.pimpl->body_stream.pimpl->is_generator;
+    }
+
+    const FileRegion *HttpResponseReader::file_body(const HttpResponse &response)
+    {
+        return response.pimpl->file_body.file ? &response.pimpl->file_body : nullptr;
+    }
+
+    const std::vector<BodyPart> &HttpResponseReader::file_parts(const HttpResponse &response)
+    {
+        return response.pimpl->file_parts;
+    }
+
+    bool HttpResponseReader::body_size(const HttpResponse &response, uint64_t &size)
+    {
+        const HttpResponse::Impl &impl = *response.pimpl;
+        const auto &stream = *impl.body_stream.pimpl;
+        if (impl.file_body.file)
+        {
+            size = impl.file_body.length;
+            return impl.file_parts.size() == 1 && impl.file_parts[0].length == size;
+        }
+        if (impl.snapshot)
+        {
+            size = impl.snapshot.pimpl->bytes.size() - impl.snapshot.pimpl->body_offset;
+            return true;
+        }
+        if (stream.is_generator || !stream.parts.empty())
+        {
+            return false;
+        }
+        size = stream.body_data.size();
+        return true;
+    }
+
+    const std::unordered_map<std::string, std::string> &HttpResponseReader::sent_headers(const HttpResponse &response)
+    {
+        return response.pimpl->snapshot ? response.pimpl->snapshot.pimpl->headers : response._headers;
+    }
+
+    const std::string *HttpResponseReader::preformatted_head(const HttpResponse &response)
+    {
+        return response.pimpl->preformatted_head;
+    }
+
+    bool HttpResponseReader::snapshot_view(const HttpResponse &response, SnapshotView &view)
+    {
+        const HttpResponseSnapshot &snapshot = response.pimpl->snapshot;
+        if (!snapshot)
+        {
+            return false;
+        }
+        view.data = snapshot.pimpl->bytes.data();
+        view.size = snapshot.pimpl->bytes.size();
+        view.status_line_size = snapshot.pimpl->status_line_size;
+        view.has_date_header = snapshot.pimpl->has_date_header;
+        view.has_server_header = snapshot.pimpl->has_server_header;
+        return true;
+    }
+
+    bool HttpResponseReader::park_body_consumer(const HttpResponse &response)
+    {
+        if (!response.pimpl->body_stream.pimpl->producer)
+        {
+            return false;
+        }
+        return response.pimpl->body_stream.pimpl->producer->park_consumer();
     }
-}
\ No newline at end of file
+}
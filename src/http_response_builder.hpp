@@ -2,13 +2,34 @@
 #define HTTP_RESPONSE_BUILDER_HPP
 
 #include "http/http_response.hpp"
+#include "byte_ranges.hpp"
+
+#include <vector>
 
 namespace http
 {
+    struct FileRegion;
+
     struct HttpResponseBuilder
     {
         static HttpResponse build();
+        /// @brief Builds a response without headers or body, as used for server-generated errors.
+        /// Until it is modified, a standard status code with its standard reason phrase is sent with a constant
+        /// preformatted head that closes the connection, see HttpResponseReader::preformatted_head.
         static HttpResponse build(int status_code, const std::string &reason_phrase);
+        /// @brief Returns a response to the state produced by build(), keeping header and body buffer storage for reuse.
+        static void reset(HttpResponse &response);
+        /// @brief Removes a header, key must be lowercase.
+        static void remove_header(HttpResponse &response, const std::string &key);
+        /// @brief Sends the body from a file region instead of a body stream, without copying it through user space where the platform allows it.
+        /// The Content-Length header is set to the region's length when the response is sent.
+        static void set_body_file(HttpResponse &response, const FileRegion &region);
+        /// @brief Sends only the given parts of the body set with set_body, set_body_file or set_snapshot, reading none of the other bytes.
+        /// A snapshot is turned back into a regular response with the snapshot's status and headers.
+        /// Headers are left alone, the caller sets Content-Length to the parts' total size.
+        /// @param parts Offsets relative to the start of the body, in sending order.
+        /// @throws std::logic_error If the body was set with set_body_generator.
+        static void select_body_parts(HttpResponse &response, std::vector<BodyPart> parts);
     };
 }
 
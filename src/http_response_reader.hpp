@@ -5,14 +5,34 @@
 #define HTTP_RESPONSE_READER_HPP
 
 #include "http/http_response.hpp"
+#include "buffer_pool.hpp"
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace http
 {
+    class BodyProducer;
+    struct FileRegion;
+    struct BodyPart;
+
     /// @brief A utility class for reading the body stream of an HTTP response.
     struct HttpResponseReader
     {
+        /// @brief Wire bytes of a snapshot set with HttpResponse::set_snapshot.
+        struct SnapshotView
+        {
+            const char *data = nullptr;
+            size_t size = 0;
+            /// Bytes of the status line at the start of data, the Date and Server lines go after it.
+            size_t status_line_size = 0;
+            bool has_date_header = false;
+            bool has_server_header = false;
+        };
+
         /// @brief Reads the body stream of an HTTP response into a buffer.
         /// Repeated calls continue consuming the same underlying response body stream.
         /// @param response The HTTP response from which to read the body.
@@ -20,7 +40,42 @@ namespace http
         /// @param buffer_pointer The position in the buffer where reading should start.
         /// @param max_size The maximum number of bytes to read.
         /// @return Bytes read for this call. Returns -1 when the response body is fully consumed.
-        static int64_t read_body_stream(const HttpResponse &response, std::vector<char> &buffer, size_t buffer_pointer = 0, size_t max_size = static_cast<size_t>(-1));
+        /// Returns 0 while an asynchronously produced body has no bytes buffered yet.
+        static int64_t read_body_stream(const HttpResponse &response, IoBuffer &buffer, size_t buffer_pointer = 0, size_t max_size = static_cast<size_t>(-1));
+
+        /// @brief Moves the body generator of the response into a BodyProducer so it can run on another thread.
+        /// Later read_body_stream calls drain the producer's buffer.
+        /// @return The producer, or nullptr if the body was not set through set_body_generator.
+        static std::shared_ptr<BodyProducer> make_body_producer(const HttpResponse &response, size_t high_watermark, size_t low_watermark);
+
+        /// @brief Parks the sender of an asynchronously produced body until more bytes are buffered.
+        /// @return True if parked, the producer's data wakeup resumes sending; false if the caller should continue itself.
+        static bool park_body_consumer(const HttpResponse &response);
+
+        /// @return True if the body was set through set_body_generator, also once it was moved into a BodyProducer.
+        static bool has_body_generator(const HttpResponse &response);
+
+        /// @return The file region set with HttpResponseBuilder::set_body_file, or nullptr if the body is not sent from a file.
+        static const FileRegion *file_body(const HttpResponse &response);
+
+        /// @return The parts of the file body that are sent, offsets relative to the file region.
+        static const std::vector<BodyPart> &file_parts(const HttpResponse &response);
+
+        /// @brief Gets the size of a body whose parts can be selected, see HttpResponseBuilder::select_body_parts.
+        /// @return False for generated bodies and for bodies already narrowed to parts.
+        static bool body_size(const HttpResponse &response, uint64_t &size);
+
+        /// @return Headers the response is sent with: the snapshot's if one is set, the response's own otherwise.
+        static const std::unordered_map<std::string, std::string> &sent_headers(const HttpResponse &response);
+
+        /// @brief Returns the constant head of a response built by HttpResponseBuilder::build(status_code, reason_phrase)
+        /// with a standard reason phrase and not modified since.
+        /// @return The complete head to send as is, or nullptr if the head has to be encoded.
+        static const std::string *preformatted_head(const HttpResponse &response);
+
+        /// @brief Looks up the snapshot the response sends instead of its own status line, headers and body.
+        /// @return True if a snapshot is set; view then points into its bytes, valid while the response holds it.
+        static bool snapshot_view(const HttpResponse &response, SnapshotView &view);
     };
 }
 
@@ -0,0 +1,85 @@
+#include "request_body_decoder.hpp"
+
+#include "http_exceptions.hpp"
+
+#include <utility>
+
+http::RequestBodyDecoder::RequestBodyDecoder(DataStream &&source, std::unique_ptr<Decompressor> decompressor, size_t buffer_size, size_t max_decoded_size)
+    : source(std::move(source)), decompressor(std::move(decompressor)), input(buffer_size), output(buffer_size), max_decoded_size(max_decoded_size) {}
+
+void http::RequestBodyDecoder::decode_more()
+{
+    output_cursor = 0;
+    output_size = 0;
+    while (!closed)
+    {
+        if (finished)
+        {
+            // The compressed stream ended, the body has to end with it.
+            if (input_cursor < input_size || source.get_next(input, 0, 1) > 0)
+            {
+                throw http::exceptions::InvalidContentEncoding("Data after the end of the compressed body.");
+            }
+            closed = source.is_stream_closed();
+            return;
+        }
+
+        if (input_cursor == input_size && !output_pending)
+        {
+            input_cursor = 0;
+            input_size = source.get_next(input);
+            if (input_size == 0)
+            {
+                if (source.is_stream_closed())
+                {
+                    throw http::exceptions::InvalidContentEncoding("Compressed body is truncated.");
+                }
+                return;
+            }
+        }
+
+        Decompressor::Result result;
+        try
+        {
+            result = decompressor->decompress(input.data() + input_cursor, input_size - input_cursor, output.data(), output.size());
+        }
+        catch (const std::exception &e)
+        {
+            throw http::exceptions::InvalidContentEncoding(e.what());
+        }
+        if (result.consumed == 0 && result.produced == 0 && !result.finished && input_cursor < input_size)
+        {
+            throw http::exceptions::InvalidContentEncoding("Decompressor made no progress.");
+        }
+        input_cursor += result.consumed;
+        finished = result.finished;
+        output_pending = result.produced == output.size();
+
+        decoded_size += result.produced;
+        if (decoded_size > max_decoded_size)
+        {
+            throw http::exceptions::PayloadTooLarge("Decompressed request body exceeds the limit.");
+        }
+        if (result.produced > 0)
+        {
+            output_size = result.produced;
+            return;
+        }
+    }
+}
+
+http::DataStream::StreamView http::RequestBodyDecoder::view() noexcept
+{
+    DataStream::StreamView view;
+    view.data = output.data();
+    view.size = output_size;
+    view.cursor = output_cursor;
+    view.is_closed = closed && output_cursor == output_size;
+    view.error = false;
+    return view;
+}
+
+void http::RequestBodyDecoder::advance(size_t bytes) noexcept
+{
+    output_cursor += bytes;
+}
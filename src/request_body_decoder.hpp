@@ -0,0 +1,54 @@
+#ifndef REQUEST_BODY_DECODER_HPP
+#define REQUEST_BODY_DECODER_HPP
+
+#include "data_stream.hpp"
+#include "http/http_compression.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace http
+{
+    /// Decompresses a request body read from a DataStream, one output buffer at a time.
+    /// Used as the provider of the stream handed to the handler: decode_more() is the updater,
+    /// view() the view provider and advance() the cursor advancer. Only one buffer each of
+    /// compressed and decompressed bytes is held, whatever the body size.
+    class RequestBodyDecoder
+    {
+    private:
+        DataStream source;
+        std::unique_ptr<Decompressor> decompressor;
+        std::vector<char> input;
+        size_t input_cursor = 0;
+        size_t input_size = 0;
+        std::vector<char> output;
+        size_t output_cursor = 0;
+        size_t output_size = 0;
+        // The last call filled output, the decompressor may hold more without new input.
+        bool output_pending = false;
+        bool finished = false;
+        bool closed = false;
+        size_t decoded_size = 0;
+        size_t max_decoded_size;
+
+    public:
+        /// @param source Stream of the compressed body, taken over.
+        /// @param decompressor Decompressor for the body's content coding.
+        /// @param buffer_size Size of the compressed and of the decompressed buffer.
+        /// @param max_decoded_size Decompressed bytes allowed in total.
+        RequestBodyDecoder(DataStream &&source, std::unique_ptr<Decompressor> decompressor, size_t buffer_size, size_t max_decoded_size);
+
+        /// @brief Replaces the consumed output with newly decompressed bytes, reading compressed bytes as needed.
+        /// Produces nothing if the source has no new bytes yet.
+        /// @throws http::exceptions::PayloadTooLarge If the body decompresses to more than max_decoded_size.
+        /// @throws http::exceptions::InvalidContentEncoding If the body is not valid for its coding, is truncated or has bytes after its end.
+        void decode_more();
+
+        DataStream::StreamView view() noexcept;
+
+        void advance(size_t bytes) noexcept;
+    };
+}
+
+#endif // REQUEST_BODY_DECODER_HPP
@@ -0,0 +1,61 @@
+#ifndef REQUEST_COALESCER_HPP
+#define REQUEST_COALESCER_HPP
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace http
+{
+    class HttpConnection;
+
+    /// Tracks requests in flight by key (see ResponseSharing::make_key) so identical requests run the handler once.
+    /// The first request of a key leads the flight and goes to a handler thread; later ones only join it and
+    /// are parked without a thread until the leader's response is ready.
+    class RequestCoalescer
+    {
+    private:
+        std::mutex mutex;
+        // Parked connections of every running flight.
+        std::unordered_map<std::string, std::vector<HttpConnection *>> flights;
+
+    public:
+        RequestCoalescer() = default;
+
+        RequestCoalescer(const RequestCoalescer &) = delete;
+        RequestCoalescer &operator=(const RequestCoalescer &) = delete;
+
+        /// @brief Joins the flight of key, or starts one.
+        /// @return True if a flight was running and connection now waits for it; false if the caller leads a new flight.
+        bool join(const std::string &key, HttpConnection &connection)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto flight = flights.find(key);
+            if (flight == flights.end())
+            {
+                flights.emplace(key, std::vector<HttpConnection *>());
+                return false;
+            }
+            flight->second.push_back(&connection);
+            return true;
+        }
+
+        /// @brief Ends the flight of key; requests arriving afterwards start a new one.
+        /// @return The connections that joined it.
+        std::vector<HttpConnection *> finish(const std::string &key)
+        {
+            std::vector<HttpConnection *> followers;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto flight = flights.find(key);
+            if (flight != flights.end())
+            {
+                followers.swap(flight->second);
+                flights.erase(flight);
+            }
+            return followers;
+        }
+    };
+}
+
+#endif // REQUEST_COALESCER_HPP
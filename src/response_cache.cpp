@@ -0,0 +1,321 @@
+#include "response_cache.hpp"
+
+#include "http/http_constants.hpp"
+#include "http_response_builder.hpp"
+#include "http_response_reader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+
+namespace
+{
+    // Per entry bookkeeping that is not snapshot bytes or key: list node, index node and the Entry itself.
+    const size_t ENTRY_OVERHEAD = 256;
+
+    /// Splits a comma separated header value into trimmed elements, lowercased if asked to.
+    std::vector<std::string> split_list(const std::string &value, bool lowercase)
+    {
+        std::vector<std::string> elements;
+        size_t position = 0;
+        while (position <= value.size())
+        {
+            size_t end = value.find(',', position);
+            if (end == std::string::npos)
+            {
+                end = value.size();
+            }
+            size_t begin = position;
+            while (begin < end && (value[begin] == ' ' || value[begin] == '\t'))
+            {
+                ++begin;
+            }
+            size_t last = end;
+            while (last > begin && (value[last - 1] == ' ' || value[last - 1] == '\t'))
+            {
+                --last;
+            }
+            if (last > begin)
+            {
+                std::string element = value.substr(begin, last - begin);
+                if (lowercase)
+                {
+                    for (char &c : element)
+                    {
+                        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                    }
+                }
+                elements.push_back(std::move(element));
+            }
+            position = end + 1;
+        }
+        return elements;
+    }
+
+    /// @return Seconds from a "name=value" directive, the value may be quoted; -1 if not a valid number.
+    long directive_seconds(const std::string &directive, size_t name_size)
+    {
+        std::string value = directive.substr(name_size);
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+        {
+            value = value.substr(1, value.size() - 2);
+        }
+        if (value.empty() || !std::all_of(value.begin(), value.end(), [](char c)
+                                          { return c >= '0' && c <= '9'; }))
+        {
+            return -1;
+        }
+        return std::strtol(value.c_str(), nullptr, 10);
+    }
+
+    /// @return Freshness lifetime in seconds from a response's Cache-Control, 0 if it must not be stored.
+    long freshness_lifetime(const std::string &cache_control)
+    {
+        long max_age = 0;
+        long shared_max_age = -1;
+        for (const std::string &directive : split_list(cache_control, true))
+        {
+            if (directive == "no-store" || directive == "no-cache" || directive == "private" || directive.compare(0, 9, "no-cache=") == 0 || directive.compare(0, 8, "private=") == 0)
+            {
+                return 0;
+            }
+            if (directive.compare(0, 8, "max-age=") == 0)
+            {
+                max_age = std::max(directive_seconds(directive, 8), 0L);
+            }
+            else if (directive.compare(0, 9, "s-maxage=") == 0)
+            {
+                shared_max_age = directive_seconds(directive, 9);
+            }
+        }
+        // The server cache is shared between clients, s-maxage takes precedence.
+        return shared_max_age >= 0 ? shared_max_age : max_age;
+    }
+
+    /// Status codes cacheable by default, RFC 7231 section 6.1.
+    bool is_cacheable_status(int status_code)
+    {
+        switch (status_code)
+        {
+        case 200:
+        case 203:
+        case 204:
+        case 300:
+        case 301:
+        case 404:
+        case 405:
+        case 410:
+        case 414:
+        case 501:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /// @return The header value, or nullptr if absent.
+    const std::string *find_header(const std::unordered_map<std::string, std::string> &headers, const std::string &name)
+    {
+        auto header = headers.find(name);
+        return header == headers.end() ? nullptr : &header->second;
+    }
+
+    std::string strip_weak(const std::string &etag)
+    {
+        return etag.compare(0, 2, "W/") == 0 ? etag.substr(2) : etag;
+    }
+}
+
+http::ResponseSharing::ResponseSharing(const std::vector<std::string> &vary_headers)
+{
+    for (const std::string &header : vary_headers)
+    {
+        std::vector<std::string> names = split_list(header, true);
+        this->vary_headers.insert(this->vary_headers.end(), names.begin(), names.end());
+    }
+}
+
+bool http::ResponseSharing::make_key(const HttpRequest &request, std::string &key) const
+{
+    const auto &headers = request.headers();
+    if (request.method() != http::methods::GET || headers.count(http::headers::AUTHORIZATION) != 0 || headers.count(http::headers::TRANSFER_ENCODING) != 0)
+    {
+        return false;
+    }
+    const std::string *content_length = find_header(headers, http::headers::CONTENT_LENGTH);
+    if (content_length && *content_length != "0")
+    {
+        return false;
+    }
+    const std::string *pragma = find_header(headers, http::headers::PRAGMA);
+    const std::string *cache_control = find_header(headers, http::headers::CACHE_CONTROL);
+    if (pragma && pragma->find("no-cache") != std::string::npos)
+    {
+        return false;
+    }
+    if (cache_control)
+    {
+        for (const std::string &directive : split_list(*cache_control, true))
+        {
+            if (directive == "no-cache" || directive == "no-store")
+            {
+                return false;
+            }
+        }
+    }
+
+    key = request.uri();
+    for (const std::string &name : vary_headers)
+    {
+        // '\n' can not occur in a URI or header value, an absent header differs from an empty one.
+        const std::string *value = find_header(headers, name);
+        key += '\n';
+        if (value)
+        {
+            key += '=';
+            key += *value;
+        }
+    }
+    return true;
+}
+
+bool http::ResponseSharing::is_shareable(const HttpResponse &response) const
+{
+    HttpResponseReader::SnapshotView snapshot;
+    if (HttpResponseReader::snapshot_view(response, snapshot))
+    {
+        return true;
+    }
+    const auto &headers = response.headers();
+    if (HttpResponseReader::has_body_generator(response) || HttpResponseReader::file_body(response) || headers.count(http::headers::SET_COOKIE) != 0 || headers.count(http::headers::TRANSFER_ENCODING) != 0)
+    {
+        return false;
+    }
+    if (const std::string *cache_control = find_header(headers, http::headers::CACHE_CONTROL))
+    {
+        for (const std::string &directive : split_list(*cache_control, true))
+        {
+            if (directive == "no-store" || directive == "private" || directive.compare(0, 8, "private=") == 0)
+            {
+                return false;
+            }
+        }
+    }
+    if (const std::string *vary = find_header(headers, http::headers::VARY))
+    {
+        for (const std::string &name : split_list(*vary, true))
+        {
+            if (std::find(vary_headers.begin(), vary_headers.end(), name) == vary_headers.end())
+            {
+                return false; // Also "*".
+            }
+        }
+    }
+    return true;
+}
+
+http::ResponseCache::ResponseCache(size_t capacity, const ResponseSharing &sharing) : shard_capacity(capacity / SHARD_COUNT), sharing(sharing) {}
+
+http::ResponseCache::Shard &http::ResponseCache::shard(const std::string &key)
+{
+    return shards[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+void http::ResponseCache::erase(Shard &shard, std::list<std::pair<std::string, std::shared_ptr<const Entry>>>::iterator entry)
+{
+    shard.size -= entry->first.size() + entry->second->response.size() + entry->second->not_modified.size() + ENTRY_OVERHEAD;
+    shard.index.erase(entry->first);
+    shard.entries.erase(entry);
+}
+
+std::shared_ptr<const http::ResponseCache::Entry> http::ResponseCache::find(const std::string &key, Clock::time_point now)
+{
+    Shard &key_shard = shard(key);
+    std::lock_guard<std::mutex> lock(key_shard.mutex);
+    auto position = key_shard.index.find(key);
+    if (position == key_shard.index.end())
+    {
+        return nullptr;
+    }
+    auto entry = position->second;
+    if (entry->second->expires <= now)
+    {
+        erase(key_shard, entry);
+        return nullptr;
+    }
+    key_shard.entries.splice(key_shard.entries.begin(), key_shard.entries, entry);
+    return entry->second;
+}
+
+std::shared_ptr<const http::ResponseCache::Entry> http::ResponseCache::store(const std::string &key, const HttpResponse &response, Clock::time_point now)
+{
+    HttpResponseReader::SnapshotView snapshot;
+    if (!is_cacheable_status(response.status_code()) || HttpResponseReader::snapshot_view(response, snapshot) || !sharing.is_shareable(response))
+    {
+        return nullptr;
+    }
+    const auto &headers = response.headers();
+    const std::string *cache_control = find_header(headers, http::headers::CACHE_CONTROL);
+    long lifetime = cache_control ? freshness_lifetime(*cache_control) : 0;
+    if (lifetime <= 0)
+    {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<Entry>();
+    entry->response = response.freeze();
+    entry->expires = now + std::chrono::seconds(lifetime);
+    const std::string *etag = find_header(headers, http::headers::ETAG);
+    if (etag && response.status_code() == http::status_codes::OK)
+    {
+        entry->etag = *etag;
+        // RFC 7232 section 4.1: the headers a 200 would have sent that describe caching of the representation.
+        HttpResponse not_modified = HttpResponseBuilder::build();
+        not_modified.set_status_code(http::status_codes::NOT_MODIFIED);
+        not_modified.set_reason_phrase("Not Modified");
+        for (const std::string *name : {&http::headers::ETAG, &http::headers::CACHE_CONTROL, &http::headers::VARY, &http::headers::EXPIRES, &http::headers::CONTENT_LOCATION, &http::headers::DATE})
+        {
+            if (const std::string *value = find_header(headers, *name))
+            {
+                not_modified.set_header(*name, *value);
+            }
+        }
+        entry->not_modified = not_modified.freeze();
+    }
+
+    size_t entry_size = key.size() + entry->response.size() + entry->not_modified.size() + ENTRY_OVERHEAD;
+    if (entry_size > shard_capacity)
+    {
+        return nullptr;
+    }
+
+    Shard &key_shard = shard(key);
+    std::lock_guard<std::mutex> lock(key_shard.mutex);
+    auto position = key_shard.index.find(key);
+    if (position != key_shard.index.end())
+    {
+        erase(key_shard, position->second);
+    }
+    while (key_shard.size + entry_size > shard_capacity)
+    {
+        erase(key_shard, std::prev(key_shard.entries.end()));
+    }
+    key_shard.entries.emplace_front(key, entry);
+    key_shard.index.emplace(key, key_shard.entries.begin());
+    key_shard.size += entry_size;
+    return entry;
+}
+
+bool http::ResponseCache::etag_matches(const std::string &if_none_match, const std::string &etag)
+{
+    std::string opaque_tag = strip_weak(etag);
+    for (const std::string &candidate : split_list(if_none_match, false))
+    {
+        if (candidate == "*" || strip_weak(candidate) == opaque_tag)
+        {
+            return true;
+        }
+    }
+    return false;
+}
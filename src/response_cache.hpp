@@ -0,0 +1,108 @@
+#ifndef RESPONSE_CACHE_HPP
+#define RESPONSE_CACHE_HPP
+
+#include "http/http_request.hpp"
+#include "http/http_response.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace http
+{
+    /// Rules for answering several requests with one handler response, shared by the response cache and request coalescing.
+    class ResponseSharing
+    {
+    private:
+        // Lowercase request header names whose values are part of the key.
+        std::vector<std::string> vary_headers;
+
+    public:
+        /// @param vary_headers Request headers responses may vary on; responses that vary on other headers are not shared.
+        explicit ResponseSharing(const std::vector<std::string> &vary_headers);
+
+        /// @brief Builds the key of a request, requests with equal keys may get the same response.
+        /// Only GET requests without a body, credentials or a no-cache/no-store directive get a key.
+        /// @return False if the request has to go to the handler on its own.
+        bool make_key(const HttpRequest &request, std::string &key) const;
+
+        /// @brief Checks that a handled response may go to every request with its key: no private or no-store directive,
+        /// no Set-Cookie, a body that is neither a generator nor a file and Vary only on the key headers. Snapshots set by the handler always may.
+        bool is_shareable(const HttpResponse &response) const;
+    };
+
+    /// Server-side cache of handler responses, kept as snapshots so a hit is sent without calling the handler.
+    /// Entries are keyed by ResponseSharing, live for the
+    /// Cache-Control max-age of the response and are evicted least recently used first once the byte budget is reached.
+    /// The cache is split into shards with a mutex each, so lookups from the event loop rarely wait for a store from a handler thread.
+    class ResponseCache
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// A cached response.
+        struct Entry
+        {
+            /// The response as sent, Connection and Content-Length included.
+            HttpResponseSnapshot response;
+            /// 304 Not Modified carrying the validator and caching headers of response; empty without an ETag.
+            HttpResponseSnapshot not_modified;
+            std::string etag;
+            Clock::time_point expires;
+        };
+
+    private:
+        static const size_t SHARD_COUNT = 16;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            // Most recently used first.
+            std::list<std::pair<std::string, std::shared_ptr<const Entry>>> entries;
+            std::unordered_map<std::string, std::list<std::pair<std::string, std::shared_ptr<const Entry>>>::iterator> index;
+            size_t size = 0;
+        };
+
+        Shard shards[SHARD_COUNT];
+        size_t shard_capacity;
+        const ResponseSharing &sharing;
+
+        Shard &shard(const std::string &key);
+        // Removes an entry; the shard mutex must be held.
+        static void erase(Shard &shard, std::list<std::pair<std::string, std::shared_ptr<const Entry>>>::iterator entry);
+
+    public:
+        /// @param capacity Budget in bytes for all entries, snapshot bytes and keys counted.
+        /// @param sharing Key and shareability rules, must outlive the cache.
+        ResponseCache(size_t capacity, const ResponseSharing &sharing);
+
+        ResponseCache(const ResponseCache &) = delete;
+        ResponseCache &operator=(const ResponseCache &) = delete;
+
+        /// @brief Builds the key of a request, see ResponseSharing::make_key.
+        bool make_key(const HttpRequest &request, std::string &key) const
+        {
+            return sharing.make_key(request, key);
+        }
+
+        /// @return The fresh entry for key, or nullptr. Expired entries are dropped.
+        std::shared_ptr<const Entry> find(const std::string &key, Clock::time_point now);
+
+        /// @brief Stores a handler response if it is shareable, has a status cacheable by default, a max-age (or s-maxage)
+        /// above zero and no no-cache directive. Snapshots set by the handler are not stored.
+        /// @param key Key from ResponseSharing::make_key.
+        /// @return The new entry, or nullptr if the response was not stored.
+        std::shared_ptr<const Entry> store(const std::string &key, const HttpResponse &response, Clock::time_point now);
+
+        /// @brief Weak comparison of an If-None-Match header against an entity tag (RFC 7232 section 3.2).
+        static bool etag_matches(const std::string &if_none_match, const std::string &etag);
+    };
+}
+
+#endif // RESPONSE_CACHE_HPP
@@ -0,0 +1,225 @@
+#include "response_compression.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+namespace
+{
+    // Compressors kept per thread and codec; more responses than this in flight on one thread allocate new ones.
+    const size_t MAX_POOLED_COMPRESSORS = 8;
+
+    struct CompressorPool
+    {
+        std::shared_ptr<http::CompressionCodec> codec;
+        int level;
+        std::vector<std::unique_ptr<http::Compressor>> compressors;
+    };
+
+    // Responses can finish on another thread than they started on, each thread simply keeps what it released.
+    thread_local std::vector<CompressorPool> compressor_pools;
+
+    CompressorPool *find_pool(const std::shared_ptr<http::CompressionCodec> &codec, int level)
+    {
+        for (CompressorPool &pool : compressor_pools)
+        {
+            if (pool.codec == codec && pool.level == level)
+            {
+                return &pool;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string trim_lower(const std::string &value, size_t begin, size_t end)
+    {
+        while (begin < end && (value[begin] == ' ' || value[begin] == '\t'))
+        {
+            ++begin;
+        }
+        while (end > begin && (value[end - 1] == ' ' || value[end - 1] == '\t'))
+        {
+            --end;
+        }
+        std::string result = value.substr(begin, end - begin);
+        for (char &c : result)
+        {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return result;
+    }
+
+    /// @return The q-value of an Accept-Encoding element's parameters, 1 if absent.
+    double parse_quality(const std::string &parameters)
+    {
+        size_t position = 0;
+        while (position < parameters.size())
+        {
+            size_t end = parameters.find(';', position);
+            if (end == std::string::npos)
+            {
+                end = parameters.size();
+            }
+            std::string parameter = trim_lower(parameters, position, end);
+            if (parameter.size() > 2 && parameter[0] == 'q' && parameter[1] == '=')
+            {
+                return std::strtod(parameter.c_str() + 2, nullptr);
+            }
+            position = end + 1;
+        }
+        return 1.0;
+    }
+
+    /// @brief Ranks the codings named by name(0) .. name(count - 1) by the q-values of an Accept-Encoding header.
+    /// @return Index of the best coding, -1 if none is acceptable.
+    template <typename Name>
+    int negotiate_index(const std::string &accept_encoding, size_t count, Name name)
+    {
+        std::vector<double> qualities(count, -1.0);
+        double wildcard_quality = -1.0;
+
+        size_t position = 0;
+        while (position < accept_encoding.size())
+        {
+            size_t end = accept_encoding.find(',', position);
+            if (end == std::string::npos)
+            {
+                end = accept_encoding.size();
+            }
+            size_t parameters = accept_encoding.find(';', position);
+            size_t token_end = parameters < end ? parameters : end;
+            std::string coding = trim_lower(accept_encoding, position, token_end);
+            double quality = parameters < end ? parse_quality(accept_encoding.substr(parameters + 1, end - parameters - 1)) : 1.0;
+
+            if (coding == "*")
+            {
+                wildcard_quality = quality;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (name(i) == coding)
+                {
+                    qualities[i] = quality;
+                }
+            }
+            position = end + 1;
+        }
+
+        int best = -1;
+        double best_quality = 0.0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            double quality = qualities[i] >= 0.0 ? qualities[i] : wildcard_quality;
+            // Strictly greater keeps the server's preference among equally rated codings.
+            if (quality > best_quality)
+            {
+                best = static_cast<int>(i);
+                best_quality = quality;
+            }
+        }
+        return best;
+    }
+}
+
+std::shared_ptr<http::CompressionCodec> http::ResponseCompression::negotiate(const std::string &accept_encoding, const std::vector<std::shared_ptr<CompressionCodec>> &codecs)
+{
+    int best = negotiate_index(accept_encoding, codecs.size(), [&codecs](size_t i) { return codecs[i]->name(); });
+    return best < 0 ? nullptr : codecs[best];
+}
+
+int http::ResponseCompression::negotiate(const std::string &accept_encoding, const std::vector<std::string> &codings)
+{
+    return negotiate_index(accept_encoding, codings.size(), [&codings](size_t i) -> const std::string & { return codings[i]; });
+}
+
+std::shared_ptr<http::CompressionCodec> http::ResponseCompression::find_codec(const std::string &content_encoding, const std::vector<std::shared_ptr<CompressionCodec>> &codecs)
+{
+    std::string coding = trim_lower(content_encoding, 0, content_encoding.size());
+    if (coding == "x-gzip")
+    {
+        coding = "gzip"; // RFC 7230 section 4.2.3
+    }
+    for (const std::shared_ptr<CompressionCodec> &codec : codecs)
+    {
+        if (codec->name() == coding)
+        {
+            return codec;
+        }
+    }
+    return nullptr;
+}
+
+bool http::ResponseCompression::is_compressible_type(const std::string &content_type, const std::vector<std::string> &excluded_types)
+{
+    size_t parameters = content_type.find(';');
+    std::string media_type = trim_lower(content_type, 0, parameters == std::string::npos ? content_type.size() : parameters);
+    for (const std::string &excluded : excluded_types)
+    {
+        bool is_prefix = !excluded.empty() && excluded.back() == '/';
+        if (is_prefix ? media_type.compare(0, excluded.size(), excluded) == 0 : media_type == excluded)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool http::ResponseCompression::list_contains(const std::string &list, const std::string &token)
+{
+    size_t position = 0;
+    while (position < list.size())
+    {
+        size_t end = list.find(',', position);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        if (trim_lower(list, position, end) == token)
+        {
+            return true;
+        }
+        position = end + 1;
+    }
+    return false;
+}
+
+std::unique_ptr<http::Compressor> http::ResponseCompression::acquire_compressor(const std::shared_ptr<CompressionCodec> &codec, int level)
+{
+    CompressorPool *pool = find_pool(codec, level);
+    if (pool && !pool->compressors.empty())
+    {
+        std::unique_ptr<Compressor> compressor = std::move(pool->compressors.back());
+        pool->compressors.pop_back();
+        return compressor;
+    }
+    return codec->create_compressor(level);
+}
+
+void http::ResponseCompression::release_compressor(const std::shared_ptr<CompressionCodec> &codec, int level, std::unique_ptr<Compressor> compressor) noexcept
+{
+    try
+    {
+        compressor->reset();
+        CompressorPool *pool = find_pool(codec, level);
+        if (!pool)
+        {
+            compressor_pools.push_back(CompressorPool{codec, level, {}});
+            pool = &compressor_pools.back();
+        }
+        if (pool->compressors.size() < MAX_POOLED_COMPRESSORS)
+        {
+            pool->compressors.push_back(std::move(compressor));
+        }
+    }
+    catch (...)
+    {
+        // A compressor that can not be reset or pooled is simply dropped.
+    }
+}
+
+#ifndef HTTP_WITH_ZLIB
+std::vector<std::shared_ptr<http::CompressionCodec>> http::ResponseCompression::builtin_codecs()
+{
+    return {};
+}
+#endif
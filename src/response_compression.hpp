@@ -0,0 +1,54 @@
+#ifndef RESPONSE_COMPRESSION_HPP
+#define RESPONSE_COMPRESSION_HPP
+
+#include "http/http_compression.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace http
+{
+    /// Content coding negotiation and per-thread compressor pooling for response compression, codec lookup for request decoding.
+    struct ResponseCompression
+    {
+        /// @brief Picks the content coding for a request.
+        /// Codings are ranked by their Accept-Encoding q-value, ties go to the earlier entry in codecs.
+        /// "*" stands for every coding the header does not name; q=0 rules a coding out.
+        /// @param accept_encoding Value of the request's Accept-Encoding header.
+        /// @param codecs Codecs the server offers, most preferred first.
+        /// @return The chosen codec, or nullptr if the body has to be sent as it is.
+        static std::shared_ptr<CompressionCodec> negotiate(const std::string &accept_encoding, const std::vector<std::shared_ptr<CompressionCodec>> &codecs);
+
+        /// @brief Like negotiate() above, for codings the caller has ready made bodies for.
+        /// @param codings Content coding tokens, lowercase, most preferred first.
+        /// @return Index of the chosen coding, or -1 if the body has to be sent as it is.
+        static int negotiate(const std::string &accept_encoding, const std::vector<std::string> &codings);
+
+        /// @brief Finds the codec for a request's Content-Encoding.
+        /// @param content_encoding Value of the Content-Encoding header; only a single coding is decoded.
+        /// @param codecs Codecs the server offers.
+        /// @return The codec, or nullptr if the coding is unknown, "identity" or a list of codings.
+        static std::shared_ptr<CompressionCodec> find_codec(const std::string &content_encoding, const std::vector<std::shared_ptr<CompressionCodec>> &codecs);
+
+        /// @brief Checks a Content-Type against the types excluded from compression.
+        /// @param content_type Value of the Content-Type header, parameters are ignored.
+        /// @param excluded_types Media types; an entry ending in '/' matches every subtype.
+        static bool is_compressible_type(const std::string &content_type, const std::vector<std::string> &excluded_types);
+
+        /// @brief Checks a comma-separated header value (e.g. Vary) for a token, ignoring case and whitespace around elements.
+        /// @param token Lowercase token.
+        static bool list_contains(const std::string &list, const std::string &token);
+
+        /// @brief Takes a compressor from the calling thread's pool, creating one if the pool is empty.
+        static std::unique_ptr<Compressor> acquire_compressor(const std::shared_ptr<CompressionCodec> &codec, int level);
+
+        /// @brief Resets the compressor and keeps it in the calling thread's pool for a later response.
+        static void release_compressor(const std::shared_ptr<CompressionCodec> &codec, int level, std::unique_ptr<Compressor> compressor) noexcept;
+
+        /// @return The codecs built into the library: gzip and deflate with zlib, none without it.
+        static std::vector<std::shared_ptr<CompressionCodec>> builtin_codecs();
+    };
+}
+
+#endif // RESPONSE_COMPRESSION_HPP
@@ -0,0 +1,154 @@
+#ifdef HTTP_WITH_ZLIB
+
+#include "response_compression.hpp"
+
+#include <zlib.h>
+
+#include <stdexcept>
+#include <climits>
+#include <algorithm>
+
+namespace
+{
+    // deflateInit2 window bits: 15 is the zlib format HTTP calls "deflate", +16 wraps it as gzip.
+    const int ZLIB_WINDOW_BITS = 15;
+    const int GZIP_WINDOW_BITS = 15 + 16;
+    const int MEMORY_LEVEL = 8;
+
+    class ZlibCompressor : public http::Compressor
+    {
+    private:
+        z_stream stream;
+
+    public:
+        ZlibCompressor(int level, int window_bits)
+        {
+            stream.zalloc = Z_NULL;
+            stream.zfree = Z_NULL;
+            stream.opaque = Z_NULL;
+            if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+                throw std::runtime_error("HTTP: Failed to initialize zlib compressor");
+            }
+        }
+
+        ZlibCompressor(const ZlibCompressor &) = delete;
+        ZlibCompressor &operator=(const ZlibCompressor &) = delete;
+
+        ~ZlibCompressor() override
+        {
+            deflateEnd(&stream);
+        }
+
+        void reset() override
+        {
+            deflateReset(&stream);
+        }
+
+        Result compress(const char *input, size_t input_size, char *output, size_t output_size, Flush flush) override
+        {
+            uInt input_chunk = static_cast<uInt>(std::min<size_t>(input_size, UINT_MAX));
+            uInt output_chunk = static_cast<uInt>(std::min<size_t>(output_size, UINT_MAX));
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+            stream.avail_in = input_chunk;
+            stream.next_out = reinterpret_cast<Bytef *>(output);
+            stream.avail_out = output_chunk;
+
+            int mode = flush == FINISH ? Z_FINISH : flush == SYNC_FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+            int status = deflate(&stream, mode);
+            // Z_BUF_ERROR only means no progress was possible with this input and output.
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+            {
+                throw std::runtime_error("HTTP: zlib compression failed");
+            }
+
+            Result result;
+            result.consumed = input_chunk - stream.avail_in;
+            result.produced = output_chunk - stream.avail_out;
+            result.finished = status == Z_STREAM_END;
+            return result;
+        }
+    };
+
+    class ZlibDecompressor : public http::Decompressor
+    {
+    private:
+        z_stream stream;
+
+    public:
+        explicit ZlibDecompressor(int window_bits)
+        {
+            stream.zalloc = Z_NULL;
+            stream.zfree = Z_NULL;
+            stream.opaque = Z_NULL;
+            stream.next_in = Z_NULL;
+            stream.avail_in = 0;
+            if (inflateInit2(&stream, window_bits) != Z_OK)
+            {
+                throw std::runtime_error("HTTP: Failed to initialize zlib decompressor");
+            }
+        }
+
+        ZlibDecompressor(const ZlibDecompressor &) = delete;
+        ZlibDecompressor &operator=(const ZlibDecompressor &) = delete;
+
+        ~ZlibDecompressor() override
+        {
+            inflateEnd(&stream);
+        }
+
+        Result decompress(const char *input, size_t input_size, char *output, size_t output_size) override
+        {
+            uInt input_chunk = static_cast<uInt>(std::min<size_t>(input_size, UINT_MAX));
+            uInt output_chunk = static_cast<uInt>(std::min<size_t>(output_size, UINT_MAX));
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+            stream.avail_in = input_chunk;
+            stream.next_out = reinterpret_cast<Bytef *>(output);
+            stream.avail_out = output_chunk;
+
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+            {
+                throw std::runtime_error(std::string("HTTP: zlib decompression failed: ") + (stream.msg ? stream.msg : "invalid data"));
+            }
+
+            Result result;
+            result.consumed = input_chunk - stream.avail_in;
+            result.produced = output_chunk - stream.avail_out;
+            result.finished = status == Z_STREAM_END;
+            return result;
+        }
+    };
+
+    class ZlibCodec : public http::CompressionCodec
+    {
+    private:
+        std::string coding;
+        int window_bits;
+
+    public:
+        ZlibCodec(const std::string &coding, int window_bits) : coding(coding), window_bits(window_bits) {}
+
+        std::string name() const override
+        {
+            return coding;
+        }
+
+        std::unique_ptr<http::Compressor> create_compressor(int level) const override
+        {
+            return std::unique_ptr<http::Compressor>(new ZlibCompressor(level, window_bits));
+        }
+
+        std::unique_ptr<http::Decompressor> create_decompressor() const override
+        {
+            return std::unique_ptr<http::Decompressor>(new ZlibDecompressor(window_bits));
+        }
+    };
+}
+
+std::vector<std::shared_ptr<http::CompressionCodec>> http::ResponseCompression::builtin_codecs()
+{
+    return {std::make_shared<ZlibCodec>("gzip", GZIP_WINDOW_BITS), std::make_shared<ZlibCodec>("deflate", ZLIB_WINDOW_BITS)};
+}
+
+#endif
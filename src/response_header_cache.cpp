@@ -0,0 +1,125 @@
+#include "response_header_cache.hpp"
+
+#include "http/http_constants.hpp"
+
+#include <cstring>
+
+namespace
+{
+    const char WEEKDAYS[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    const char MONTHS[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    void write_two_digits(char *out, int64_t value)
+    {
+        out[0] = static_cast<char>('0' + value / 10);
+        out[1] = static_cast<char>('0' + value % 10);
+    }
+
+    /// Formats an IMF-fixdate (RFC 7231 section 7.1.1.1) without gmtime, strftime or the locale.
+    void format_imf_fixdate(time_t now, char *out)
+    {
+        int64_t seconds = static_cast<int64_t>(now);
+        int64_t days = seconds / 86400;
+        int64_t second_of_day = seconds % 86400;
+        if (second_of_day < 0)
+        {
+            second_of_day += 86400;
+            --days;
+        }
+
+        // Civil date from days since 1970-01-01, proleptic Gregorian calendar in 400 year eras.
+        int64_t z = days + 719468;
+        int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        int64_t day_of_era = z - era * 146097;
+        int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+        int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+        int64_t month_index = (5 * day_of_year + 2) / 153; // March based
+        int64_t day = day_of_year - (153 * month_index + 2) / 5 + 1;
+        int64_t month = month_index < 10 ? month_index + 3 : month_index - 9;
+        int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+        // 1970-01-01 was a Thursday.
+        int64_t weekday = (days % 7 + 11) % 7;
+
+        // Sun, 06 Nov 1994 08:49:37 GMT
+        memcpy(out, WEEKDAYS[weekday], 3);
+        out[3] = ',';
+        out[4] = ' ';
+        write_two_digits(out + 5, day);
+        out[7] = ' ';
+        memcpy(out + 8, MONTHS[month - 1], 3);
+        out[11] = ' ';
+        write_two_digits(out + 12, (year / 100) % 100);
+        write_two_digits(out + 14, year % 100);
+        out[16] = ' ';
+        write_two_digits(out + 17, second_of_day / 3600);
+        out[19] = ':';
+        write_two_digits(out + 20, second_of_day / 60 % 60);
+        out[22] = ':';
+        write_two_digits(out + 23, second_of_day % 60);
+        memcpy(out + 25, " GMT", 4);
+    }
+}
+
+http::ResponseHeaderCache::ResponseHeaderCache(const std::string &server_name)
+{
+    for (std::atomic<uint64_t> &word : date_words)
+    {
+        word.store(0, std::memory_order_relaxed);
+    }
+    if (!server_name.empty())
+    {
+        server_line = http::headers::SERVER + ":" + server_name + "\r\n";
+    }
+    refresh(time(nullptr));
+}
+
+void http::ResponseHeaderCache::refresh(time_t now) noexcept
+{
+    if (date_second.load(std::memory_order_relaxed) == now)
+    {
+        return;
+    }
+    date_second.store(now, std::memory_order_relaxed);
+
+    uint64_t words[DATE_WORDS] = {};
+    format_imf_fixdate(now, reinterpret_cast<char *>(words));
+
+    uint32_t sequence_value = sequence.load(std::memory_order_relaxed);
+    sequence.store(sequence_value + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < DATE_WORDS; ++i)
+    {
+        date_words[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence.store(sequence_value + 2, std::memory_order_release);
+}
+
+size_t http::ResponseHeaderCache::date_line_size() const noexcept
+{
+    return http::headers::DATE.size() + DATE_SIZE + 3; // ':' + "\r\n"
+}
+
+void http::ResponseHeaderCache::write_date_line(char *out) const noexcept
+{
+    uint64_t words[DATE_WORDS];
+    uint32_t sequence_value;
+    // Retried if a refresh ran in between, it only takes a few stores.
+    do
+    {
+        sequence_value = sequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < DATE_WORDS; ++i)
+        {
+            words[i] = date_words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence_value & 1) != 0 || sequence.load(std::memory_order_relaxed) != sequence_value);
+
+    // date:<IMF-fixdate>\r\n
+    memcpy(out, http::headers::DATE.data(), http::headers::DATE.size());
+    out += http::headers::DATE.size();
+    *out++ = ':';
+    memcpy(out, words, DATE_SIZE);
+    out += DATE_SIZE;
+    *out++ = '\r';
+    *out = '\n';
+}
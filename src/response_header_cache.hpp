@@ -0,0 +1,56 @@
+#ifndef RESPONSE_HEADER_CACHE_HPP
+#define RESPONSE_HEADER_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace http
+{
+    /// Preformatted header lines the server adds to every response: Date, and Server when configured.
+    /// The Date value is refreshed by one thread (the event loop) at most once per second and read
+    /// without locks by any thread serializing a response head.
+    class ResponseHeaderCache
+    {
+    public:
+        /// Length of an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+        static const size_t DATE_SIZE = 29;
+
+    private:
+        static const size_t DATE_WORDS = (DATE_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        // Seqlock: odd while the date words are being rewritten.
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint64_t> date_words[DATE_WORDS];
+        std::atomic<time_t> date_second{-1};
+        // "server:<name>\r\n", empty if no Server header is sent.
+        std::string server_line;
+
+    public:
+        /// @param server_name Value of the Server header, empty to send none.
+        explicit ResponseHeaderCache(const std::string &server_name);
+
+        ResponseHeaderCache(const ResponseHeaderCache &) = delete;
+        ResponseHeaderCache &operator=(const ResponseHeaderCache &) = delete;
+
+        /// Reformats the Date value if now falls into another second than the cached one.
+        /// Must only be called from one thread at a time.
+        void refresh(time_t now) noexcept;
+
+        /// @return Bytes write_date_line() produces, the same for every date.
+        size_t date_line_size() const noexcept;
+
+        /// Writes "date:<IMF-fixdate>\r\n", date_line_size() bytes.
+        void write_date_line(char *out) const noexcept;
+
+        /// @return "server:<name>\r\n", or an empty string if no Server header is configured.
+        const std::string &get_server_line() const noexcept
+        {
+            return server_line;
+        }
+    };
+}
+
+#endif // RESPONSE_HEADER_CACHE_HPP
@@ -0,0 +1,419 @@
+#include "http/http_router.hpp"
+#include "http/http_constants.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // Methods with a slot in every route's dispatch table, other methods are looked up by name.
+    const std::string *const METHODS[] = {
+        &http::methods::GET,
+        &http::methods::HEAD,
+        &http::methods::POST,
+        &http::methods::PUT,
+        &http::methods::DELETE,
+        &http::methods::PATCH,
+        &http::methods::OPTIONS,
+        &http::methods::TRACE,
+        &http::methods::CONNECT};
+
+    const size_t METHOD_COUNT = sizeof(METHODS) / sizeof(METHODS[0]);
+
+    /// @return The dispatch table slot of method, METHOD_COUNT if it has none.
+    size_t method_index(const std::string &method) noexcept
+    {
+        for (size_t i = 0; i < METHOD_COUNT; ++i)
+        {
+            if (*METHODS[i] == method)
+            {
+                return i;
+            }
+        }
+        return METHOD_COUNT;
+    }
+
+    /// One piece of a pattern: static text or a capture.
+    struct Piece
+    {
+        enum Kind
+        {
+            TEXT,
+            PARAM,
+            WILDCARD
+        };
+
+        Kind kind;
+        std::string text;
+    };
+
+    std::vector<Piece> parse_pattern(const std::string &pattern)
+    {
+        if (pattern.empty() || pattern[0] != '/')
+        {
+            throw std::invalid_argument("HTTP: Route pattern does not start with '/': " + pattern);
+        }
+        std::vector<Piece> pieces;
+        size_t captures = 0;
+        size_t position = 0;
+        while (position < pattern.size())
+        {
+            char c = pattern[position];
+            if (c != ':' && c != '*')
+            {
+                size_t end = pattern.find_first_of(":*", position);
+                end = end == std::string::npos ? pattern.size() : end;
+                pieces.push_back(Piece{Piece::TEXT, pattern.substr(position, end - position)});
+                position = end;
+                continue;
+            }
+            size_t end = pattern.find('/', position);
+            end = end == std::string::npos ? pattern.size() : end;
+            std::string name = pattern.substr(position + 1, end - position - 1);
+            if (name.empty() || name.find_first_of(":*") != std::string::npos)
+            {
+                throw std::invalid_argument("HTTP: Route pattern has a capture without a name: " + pattern);
+            }
+            if (c == '*' && end != pattern.size())
+            {
+                throw std::invalid_argument("HTTP: Route pattern has a wildcard before its end: " + pattern);
+            }
+            if (++captures > http::RouteParams::MAX_PARAMS)
+            {
+                throw std::invalid_argument("HTTP: Route pattern has too many captures: " + pattern);
+            }
+            for (const Piece &piece : pieces)
+            {
+                if (piece.kind != Piece::TEXT && piece.text == name)
+                {
+                    throw std::invalid_argument("HTTP: Route pattern captures '" + name + "' twice: " + pattern);
+                }
+            }
+            pieces.push_back(Piece{c == ':' ? Piece::PARAM : Piece::WILDCARD, name});
+            position = end;
+        }
+        return pieces;
+    }
+
+    /// Captured values while a path is matched, copied into RouteParams once a route is found.
+    struct Captures
+    {
+        const std::string *names[http::RouteParams::MAX_PARAMS];
+        http::PathView values[http::RouteParams::MAX_PARAMS];
+        size_t count = 0;
+    };
+}
+
+struct http::Router::Impl
+{
+    /// Handlers registered for one pattern.
+    struct Routes
+    {
+        RouteHandler handlers[METHOD_COUNT];
+        std::vector<std::pair<std::string, RouteHandler>> other_methods;
+        RouteHandler any_method;
+        /// Methods registered for the pattern in registration order, for the Allow header of 405 responses.
+        std::vector<std::string> methods;
+
+        const RouteHandler *find(const std::string &method) const noexcept
+        {
+            size_t index = method_index(method);
+            if (index < METHOD_COUNT)
+            {
+                if (handlers[index])
+                {
+                    return &handlers[index];
+                }
+            }
+            else
+            {
+                for (const auto &other : other_methods)
+                {
+                    if (other.first == method)
+                    {
+                        return &other.second;
+                    }
+                }
+            }
+            return any_method ? &any_method : nullptr;
+        }
+
+        RouteHandler &slot(const std::string &method)
+        {
+            if (method == "*")
+            {
+                return any_method;
+            }
+            size_t index = method_index(method);
+            if (index < METHOD_COUNT)
+            {
+                return handlers[index];
+            }
+            for (auto &other : other_methods)
+            {
+                if (other.first == method)
+                {
+                    return other.second;
+                }
+            }
+            other_methods.emplace_back(method, RouteHandler());
+            return other_methods.back().second;
+        }
+    };
+
+    /// A radix tree node. A static node matches its prefix; a capture node matches a segment (param) or the rest of the path (wildcard).
+    struct Node
+    {
+        std::string prefix;
+        /// First byte of every static child's prefix, in the order of children.
+        std::string indices;
+        std::vector<std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;
+        std::unique_ptr<Node> wildcard;
+        /// Capture name of a param or wildcard node.
+        std::string name;
+        /// Handlers of the pattern ending at this node, null if none does.
+        std::unique_ptr<Routes> routes;
+    };
+
+    Node root;
+
+    /// @return The node at which text, starting below node, ends; nodes are split or created as needed.
+    static Node &insert_text(Node &node, const std::string &text, size_t position)
+    {
+        if (position == text.size())
+        {
+            return node;
+        }
+        size_t index = node.indices.find(text[position]);
+        if (index == std::string::npos)
+        {
+            std::unique_ptr<Node> child(new Node());
+            child->prefix = text.substr(position);
+            node.indices.push_back(text[position]);
+            node.children.push_back(std::move(child));
+            return *node.children.back();
+        }
+
+        std::unique_ptr<Node> &child = node.children[index];
+        size_t common = 0;
+        while (common < child->prefix.size() && position + common < text.size() && child->prefix[common] == text[position + common])
+        {
+            ++common;
+        }
+        if (common < child->prefix.size())
+        {
+            // The child keeps the part after the shared bytes below a new node holding them.
+            std::unique_ptr<Node> split(new Node());
+            split->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            split->indices.push_back(child->prefix[0]);
+            split->children.push_back(std::move(child));
+            child = std::move(split);
+        }
+        return insert_text(*child, text, position + common);
+    }
+
+    static Node &insert_capture(std::unique_ptr<Node> &capture, const std::string &name, const std::string &pattern)
+    {
+        if (!capture)
+        {
+            capture.reset(new Node());
+            capture->name = name;
+        }
+        else if (capture->name != name)
+        {
+            throw std::invalid_argument("HTTP: Route pattern names capture '" + name + "' where another route has '" + capture->name + "': " + pattern);
+        }
+        return *capture;
+    }
+
+    /// @brief Matches path[position..] against the children of node, whose own part of the path ends at position.
+    /// Branches are tried in precedence order; one whose route accept turns down falls back to the next one.
+    /// @param accept Called with the routes of every pattern matching the whole path until it returns true.
+    /// @return The node of the accepted route, null if none; captures holds the values of its pattern.
+    template <typename Accept>
+    static const Node *match(const Node &node, const char *path, size_t size, size_t position, Captures &captures, Accept &accept)
+    {
+        if (position == size && node.routes && accept(*node.routes))
+        {
+            return &node;
+        }
+        if (position < size)
+        {
+            size_t index = node.indices.find(path[position]);
+            if (index != std::string::npos)
+            {
+                const Node &child = *node.children[index];
+                if (size - position >= child.prefix.size() && child.prefix.compare(0, child.prefix.size(), path + position, child.prefix.size()) == 0)
+                {
+                    const Node *found = match(child, path, size, position + child.prefix.size(), captures, accept);
+                    if (found)
+                    {
+                        return found;
+                    }
+                }
+            }
+
+            if (node.param)
+            {
+                size_t end = position;
+                while (end < size && path[end] != '/')
+                {
+                    ++end;
+                }
+                if (end > position)
+                {
+                    size_t count = captures.count;
+                    captures.names[count] = &node.param->name;
+                    captures.values[count].data = path + position;
+                    captures.values[count].size = end - position;
+                    captures.count = count + 1;
+                    const Node *found = match(*node.param, path, size, end, captures, accept);
+                    if (found)
+                    {
+                        return found;
+                    }
+                    captures.count = count;
+                }
+            }
+        }
+
+        if (node.wildcard && node.wildcard->routes && accept(*node.wildcard->routes))
+        {
+            size_t count = captures.count;
+            captures.names[count] = &node.wildcard->name;
+            captures.values[count].data = path + position;
+            captures.values[count].size = size - position;
+            captures.count = count + 1;
+            return node.wildcard.get();
+        }
+        return nullptr;
+    }
+
+    /// @brief Matches the path of the request's URI, see match.
+    template <typename Accept>
+    const Node *find(const HttpRequest &request, Captures &captures, Accept &accept) const
+    {
+        const std::string &uri = request.uri();
+        size_t size = 0;
+        while (size < uri.size() && uri[size] != '?' && uri[size] != '#')
+        {
+            ++size;
+        }
+        return match(root, uri.data(), size, 0, captures, accept);
+    }
+};
+
+http::Router::Router() : pimpl(std::make_shared<Impl>()) {}
+
+http::Router &http::Router::add(const std::string &method, const std::string &pattern, RouteHandler handler)
+{
+    if (method.empty())
+    {
+        throw std::invalid_argument("HTTP: Route method is empty: " + pattern);
+    }
+    if (!handler)
+    {
+        throw std::invalid_argument("HTTP: Route handler is empty: " + pattern);
+    }
+    std::vector<Piece> pieces = parse_pattern(pattern);
+
+    Impl::Node *node = &pimpl->root;
+    for (const Piece &piece : pieces)
+    {
+        switch (piece.kind)
+        {
+        case Piece::TEXT:
+            node = &Impl::insert_text(*node, piece.text, 0);
+            break;
+        case Piece::PARAM:
+            node = &Impl::insert_capture(node->param, piece.text, pattern);
+            break;
+        case Piece::WILDCARD:
+            node = &Impl::insert_capture(node->wildcard, piece.text, pattern);
+            break;
+        }
+    }
+
+    if (!node->routes)
+    {
+        node->routes.reset(new Impl::Routes());
+    }
+    RouteHandler &slot = node->routes->slot(method);
+    if (slot)
+    {
+        throw std::invalid_argument("HTTP: Route is already registered: " + method + " " + pattern);
+    }
+    slot = std::move(handler);
+    if (method != "*")
+    {
+        node->routes->methods.push_back(method);
+    }
+    return *this;
+}
+
+bool http::Router::route(const HttpRequest &request, HttpResponse &response) const
+{
+    const RouteHandler *handler = nullptr;
+    auto accept = [&request, &handler](const Impl::Routes &routes) noexcept
+    {
+        handler = routes.find(request.method());
+        return handler != nullptr;
+    };
+    Captures captures;
+    if (!pimpl->find(request, captures, accept))
+    {
+        return false;
+    }
+    RouteParams params;
+    for (size_t i = 0; i < captures.count; ++i)
+    {
+        params.params[i].name = captures.names[i];
+        params.params[i].value = captures.values[i];
+    }
+    params.count = captures.count;
+    (*handler)(request, response, params);
+    return true;
+}
+
+void http::Router::operator()(const HttpRequest &request, HttpResponse &response) const
+{
+    if (route(request, response))
+    {
+        return;
+    }
+    // Every pattern matching the path is visited, the methods of all of them are allowed.
+    std::vector<const std::string *> methods;
+    auto collect = [&methods](const Impl::Routes &routes)
+    {
+        for (const std::string &method : routes.methods)
+        {
+            if (std::find_if(methods.begin(), methods.end(), [&method](const std::string *known)
+                             { return *known == method; }) == methods.end())
+            {
+                methods.push_back(&method);
+            }
+        }
+        return false;
+    };
+    Captures captures;
+    pimpl->find(request, captures, collect);
+
+    if (!methods.empty())
+    {
+        std::string allow;
+        for (const std::string *method : methods)
+        {
+            allow += allow.empty() ? *method : ", " + *method;
+        }
+        response.set_status_text(http::status_codes::METHOD_NOT_ALLOWED, "Method Not Allowed");
+        response.set_header(http::headers::ALLOW, allow);
+    }
+    else
+    {
+        response.set_status_text(http::status_codes::NOT_FOUND, "Not Found");
+    }
+}
@@ -0,0 +1,808 @@
+#include "http/http_static_files.hpp"
+#include "http/http_constants.hpp"
+
+#include "http_response_builder.hpp"
+#include "response_cache.hpp"
+#include "response_compression.hpp"
+#include "static_files_watch.hpp"
+#include "file.hpp"
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <unordered_set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <cctype>
+#include <cstdio>
+
+namespace
+{
+    struct MimeType
+    {
+        const char *extension;
+        const char *type;
+    };
+
+    const MimeType MIME_TYPES[] = {
+        {"html", "text/html; charset=utf-8"},
+        {"htm", "text/html; charset=utf-8"},
+        {"css", "text/css; charset=utf-8"},
+        {"js", "text/javascript; charset=utf-8"},
+        {"mjs", "text/javascript; charset=utf-8"},
+        {"json", "application/json"},
+        {"map", "application/json"},
+        {"xml", "application/xml"},
+        {"txt", "text/plain; charset=utf-8"},
+        {"csv", "text/csv; charset=utf-8"},
+        {"md", "text/markdown; charset=utf-8"},
+        {"svg", "image/svg+xml"},
+        {"png", "image/png"},
+        {"jpg", "image/jpeg"},
+        {"jpeg", "image/jpeg"},
+        {"gif", "image/gif"},
+        {"webp", "image/webp"},
+        {"avif", "image/avif"},
+        {"ico", "image/x-icon"},
+        {"wasm", "application/wasm"},
+        {"pdf", "application/pdf"},
+        {"zip", "application/zip"},
+        {"gz", "application/gzip"},
+        {"woff", "font/woff"},
+        {"woff2", "font/woff2"},
+        {"ttf", "font/ttf"},
+        {"otf", "font/otf"},
+        {"mp3", "audio/mpeg"},
+        {"ogg", "audio/ogg"},
+        {"wav", "audio/wav"},
+        {"mp4", "video/mp4"},
+        {"webm", "video/webm"}};
+
+    const char DEFAULT_MIME_TYPE[] = "application/octet-stream";
+
+    // Content types memory_cache_compression leaves alone, entries ending in '/' match all subtypes.
+    const std::vector<std::string> COMPRESSED_TYPES = {
+        "image/png", "image/jpeg", "image/gif", "image/webp", "image/avif", "image/x-icon",
+        "audio/", "video/",
+        "application/gzip", "application/zip", "application/pdf",
+        "font/woff", "font/woff2"};
+
+    int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+
+    /// @brief Turns the path of a request target into a path relative to the root.
+    /// @param path Request target without query and fragment, percent-encoded.
+    /// @param relative_path Decoded path without the leading '/', segments joined by single slashes.
+    /// @return False if the path is not absolute, badly encoded or has a segment that must not be served.
+    bool sanitize_path(const std::string &path, std::string &relative_path)
+    {
+        if (path.empty() || path[0] != '/')
+        {
+            return false;
+        }
+        std::string decoded;
+        decoded.reserve(path.size());
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            char c = path[i];
+            if (c == '%')
+            {
+                int high = i + 2 < path.size() ? hex_value(path[i + 1]) : -1;
+                int low = high >= 0 ? hex_value(path[i + 2]) : -1;
+                if (low < 0)
+                {
+                    return false;
+                }
+                c = static_cast<char>(high * 16 + low);
+                i += 2;
+            }
+            if (c == '\0' || c == '\\')
+            {
+                return false;
+            }
+            decoded.push_back(c);
+        }
+
+        relative_path.clear();
+        size_t position = 1;
+        while (position <= decoded.size())
+        {
+            size_t end = decoded.find('/', position);
+            if (end == std::string::npos)
+            {
+                end = decoded.size();
+            }
+            if (end > position)
+            {
+                // Covers "." and ".." as well as hidden files such as .git or .env.
+                if (decoded[position] == '.')
+                {
+                    return false;
+                }
+                if (!relative_path.empty())
+                {
+                    relative_path.push_back('/');
+                }
+                relative_path.append(decoded, position, end - position);
+            }
+            position = end + 1;
+        }
+        return true;
+    }
+
+    std::string to_hex(uint64_t value)
+    {
+        char digits[17];
+        snprintf(digits, sizeof(digits), "%llx", static_cast<unsigned long long>(value));
+        return digits;
+    }
+
+    /// @return Strong validator of a file's bytes in a content coding, empty for the file as it is.
+    std::string make_etag(const http::FileStatus &status, const std::string &coding)
+    {
+        return "\"" + to_hex(static_cast<uint64_t>(status.modified)) + "-" + to_hex(status.size) + (coding.empty() ? "" : "-" + coding) + "\"";
+    }
+
+    /// @brief Compresses a whole body with a fresh compressor.
+    std::vector<char> compress_body(http::CompressionCodec &codec, int level, const std::vector<char> &body)
+    {
+        std::unique_ptr<http::Compressor> compressor = codec.create_compressor(level);
+        std::vector<char> compressed(body.size() / 2 + 64);
+        size_t consumed = 0;
+        size_t produced = 0;
+        while (true)
+        {
+            if (produced == compressed.size())
+            {
+                compressed.resize(compressed.size() * 2);
+            }
+            http::Compressor::Result result = compressor->compress(body.data() + consumed, body.size() - consumed, compressed.data() + produced, compressed.size() - produced, http::Compressor::FINISH);
+            consumed += result.consumed;
+            produced += result.produced;
+            if (result.finished)
+            {
+                break;
+            }
+        }
+        compressed.resize(produced);
+        return compressed;
+    }
+}
+
+struct http::StaticFiles::Impl
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /// The bytes sent for a file in one content coding.
+    struct Representation
+    {
+        /// Content coding, empty for the file as it is.
+        std::string coding;
+        /// Open file sent with sendfile, nullptr if the bytes are held in memory.
+        std::shared_ptr<const File> file;
+        uint64_t size = 0;
+        /// 200 response of bytes held in memory, with its body.
+        HttpResponseSnapshot response;
+        /// 304 response for the representation's ETag, prebuilt like response.
+        HttpResponseSnapshot not_modified;
+        std::string etag;
+    };
+
+    /// Status of a precompressed sibling file when the entry was loaded, by StaticFilesConfig::precompressed_files index.
+    struct Sibling
+    {
+        bool exists = false;
+        FileStatus status;
+    };
+
+    /// What a request path resolved to when it was last checked.
+    struct Entry
+    {
+        FileStatus status;
+        bool exists = false;
+        std::string content_type;
+        Representation identity;
+        /// Compressed copies, most preferred first, and their codings for negotiation.
+        std::vector<Representation> encoded;
+        std::vector<std::string> codings;
+        std::vector<Sibling> siblings;
+        Clock::time_point checked;
+        /// True if every directory up to the root is watched, the entry is then valid until a change is reported.
+        bool watched = false;
+
+        /// @return Bytes of the snapshots the entry holds.
+        size_t memory_size() const noexcept
+        {
+            size_t size = identity.response.size();
+            for (const Representation &representation : encoded)
+            {
+                size += representation.response.size();
+            }
+            return size;
+        }
+    };
+
+    struct CacheSlot
+    {
+        std::shared_ptr<const Entry> entry;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    std::string root;
+    StaticFilesConfig config;
+    // Codecs of memory_cache_compression, empty if it is disabled.
+    std::vector<std::shared_ptr<CompressionCodec>> compression_codecs;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, CacheSlot> cache;
+    // Most recently used path first.
+    std::list<std::string> lru;
+    // Bytes of the snapshots held by the cached entries.
+    size_t memory_used = 0;
+
+    // Set by StaticFilesWatch::enable, null while cached entries are revalidated by age.
+    std::unique_ptr<FileWatcher> watcher;
+    // Watched directories relative to the root ("" is the root) by watch id, and the other way round.
+    std::unordered_map<int, std::string> watches;
+    std::unordered_set<std::string> watched_directories;
+    // Counts the batches of changes applied, entries loaded while one arrived may be stale and are not cached.
+    uint64_t change_generation = 0;
+    // Reused by apply_changes, only the event loop thread reads changes.
+    std::vector<FileWatcher::Change> changes;
+
+    Impl(const std::string &root, StaticFilesConfig &&config) : root(root), config(std::move(config))
+    {
+        while (this->root.size() > 1 && (this->root.back() == '/' || this->root.back() == '\\'))
+        {
+            this->root.pop_back();
+        }
+        if (this->config.memory_cache_compression)
+        {
+            compression_codecs = this->config.compression_codecs.empty() ? ResponseCompression::builtin_codecs() : this->config.compression_codecs;
+        }
+    }
+
+    std::string content_type(const std::string &relative_path) const
+    {
+        size_t dot = relative_path.rfind('.');
+        size_t slash = relative_path.rfind('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        {
+            return DEFAULT_MIME_TYPE;
+        }
+        std::string extension = relative_path.substr(dot + 1);
+        for (char &c : extension)
+        {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        auto custom = config.mime_types.find(extension);
+        if (custom != config.mime_types.end())
+        {
+            return custom->second;
+        }
+        for (const MimeType &mime_type : MIME_TYPES)
+        {
+            if (extension == mime_type.extension)
+            {
+                return mime_type.type;
+            }
+        }
+        return DEFAULT_MIME_TYPE;
+    }
+
+    /// @brief Sets the headers a 200 and a 304 for representation share.
+    void set_entity_headers(HttpResponse &response, const Entry &entry, const Representation &representation) const
+    {
+        response.set_header(http::headers::ETAG, representation.etag);
+        if (!config.cache_control.empty())
+        {
+            response.set_header(http::headers::CACHE_CONTROL, config.cache_control);
+        }
+        if (!entry.encoded.empty())
+        {
+            response.set_header(http::headers::VARY, http::headers::ACCEPT_ENCODING);
+        }
+    }
+
+    /// @brief Prebuilds the responses of a representation, with body as the 200 body unless the representation is sent with sendfile.
+    void freeze(const Entry &entry, Representation &representation, const std::vector<char> *body) const
+    {
+        HttpResponse not_modified = HttpResponseBuilder::build();
+        not_modified.set_status_code(http::status_codes::NOT_MODIFIED);
+        not_modified.set_reason_phrase("Not Modified");
+        set_entity_headers(not_modified, entry, representation);
+        representation.not_modified = not_modified.freeze();
+        if (!body)
+        {
+            return;
+        }
+
+        HttpResponse response = HttpResponseBuilder::build();
+        response.set_status_code(http::status_codes::OK);
+        response.set_reason_phrase("OK");
+        response.set_header(http::headers::CONTENT_TYPE, entry.content_type);
+        response.set_header(http::headers::ACCEPT_RANGES, "bytes");
+        if (!representation.coding.empty())
+        {
+            response.set_header(http::headers::CONTENT_ENCODING, representation.coding);
+        }
+        set_entity_headers(response, entry, representation);
+        response.set_body(*body);
+        representation.response = response.freeze();
+    }
+
+    /// @brief Reads a file held in memory, nullptr if it is sent with sendfile.
+    std::unique_ptr<std::vector<char>> read(File &file, uint64_t size) const
+    {
+        if (size > config.memory_cache_max_file_size)
+        {
+            return nullptr;
+        }
+        std::unique_ptr<std::vector<char>> body(new std::vector<char>(static_cast<size_t>(size)));
+        body->resize(file.read_at(0, body->data(), body->size()));
+        // The bytes are served from memory from now on, the page cache does not have to keep them.
+        file.advise(File::DONT_NEED);
+        return body;
+    }
+
+    /// @brief Stats and opens the file at relative_path and its precompressed siblings.
+    std::shared_ptr<Entry> load(const std::string &relative_path) const
+    {
+        auto entry = std::make_shared<Entry>();
+        entry->checked = Clock::now();
+        std::string path = root + "/" + relative_path;
+        if (!File::status(path, entry->status))
+        {
+            return entry;
+        }
+        entry->exists = true;
+        if (!entry->status.is_regular)
+        {
+            return entry;
+        }
+
+        std::shared_ptr<File> file = File::open(path);
+        // The status of the opened file is the one of the bytes sent, the path may have been replaced in between.
+        if (!file || !file->status(entry->status))
+        {
+            entry->exists = false;
+            return entry;
+        }
+        entry->content_type = content_type(relative_path);
+
+        // Siblings are looked up first, their codings go into the Vary header of every representation.
+        std::vector<std::shared_ptr<File>> sibling_files;
+        std::vector<FileStatus> sibling_statuses;
+        entry->siblings.resize(config.precompressed_files.size());
+        for (size_t i = 0; i < config.precompressed_files.size(); ++i)
+        {
+            Sibling &sibling = entry->siblings[i];
+            std::string sibling_path = path + config.precompressed_files[i].second;
+            sibling.exists = File::status(sibling_path, sibling.status);
+            if (!sibling.exists || !sibling.status.is_regular || sibling.status.modified < entry->status.modified)
+            {
+                continue;
+            }
+            std::shared_ptr<File> sibling_file = File::open(sibling_path);
+            FileStatus opened;
+            if (!sibling_file || !sibling_file->status(opened) || !opened.same_file(sibling.status))
+            {
+                continue;
+            }
+            Representation representation;
+            representation.coding = config.precompressed_files[i].first;
+            representation.size = opened.size;
+            entry->encoded.push_back(std::move(representation));
+            entry->codings.push_back(config.precompressed_files[i].first);
+            sibling_files.push_back(std::move(sibling_file));
+            sibling_statuses.push_back(opened);
+        }
+        size_t sibling_count = entry->encoded.size();
+
+        entry->identity.size = entry->status.size;
+        std::unique_ptr<std::vector<char>> body = read(*file, entry->identity.size);
+        std::vector<std::vector<char>> compressed;
+        if (body && ResponseCompression::is_compressible_type(entry->content_type, COMPRESSED_TYPES))
+        {
+            for (const std::shared_ptr<CompressionCodec> &codec : compression_codecs)
+            {
+                std::string coding = codec->name();
+                if (std::find(entry->codings.begin(), entry->codings.end(), coding) != entry->codings.end())
+                {
+                    continue;
+                }
+                std::vector<char> bytes = compress_body(*codec, config.compression_level, *body);
+                if (bytes.size() >= body->size())
+                {
+                    continue;
+                }
+                Representation representation;
+                representation.coding = coding;
+                representation.size = bytes.size();
+                entry->encoded.push_back(std::move(representation));
+                entry->codings.push_back(coding);
+                compressed.push_back(std::move(bytes));
+            }
+        }
+
+        entry->identity.etag = make_etag(entry->status, std::string());
+        if (body)
+        {
+            freeze(*entry, entry->identity, body.get());
+        }
+        else
+        {
+            file->advise(File::SEQUENTIAL);
+            entry->identity.file = std::move(file);
+            freeze(*entry, entry->identity, nullptr);
+        }
+        for (size_t i = 0; i < sibling_count; ++i)
+        {
+            Representation &representation = entry->encoded[i];
+            std::unique_ptr<std::vector<char>> sibling_body = read(*sibling_files[i], representation.size);
+            representation.etag = make_etag(sibling_statuses[i], representation.coding);
+            if (!sibling_body)
+            {
+                sibling_files[i]->advise(File::SEQUENTIAL);
+                representation.file = std::move(sibling_files[i]);
+            }
+            freeze(*entry, representation, sibling_body.get());
+        }
+        for (size_t i = sibling_count; i < entry->encoded.size(); ++i)
+        {
+            Representation &representation = entry->encoded[i];
+            // The copy changes with the file, its validator is the file's kept apart by the coding.
+            representation.etag = make_etag(entry->status, representation.coding);
+            freeze(*entry, representation, &compressed[i - sibling_count]);
+        }
+        return entry;
+    }
+
+    /// @return True if the precompressed siblings of a cached file are the ones it was loaded with.
+    bool siblings_unchanged(const std::string &relative_path, const Entry &entry) const
+    {
+        for (size_t i = 0; i < entry.siblings.size(); ++i)
+        {
+            FileStatus status;
+            bool exists = File::status(root + "/" + relative_path + config.precompressed_files[i].second, status);
+            if (exists != entry.siblings[i].exists || (exists && !status.same_file(entry.siblings[i].status)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @return The cached entry of relative_path, loaded or revalidated first if needed.
+    std::shared_ptr<const Entry> find(const std::string &relative_path)
+    {
+        Clock::time_point now = Clock::now();
+        std::shared_ptr<const Entry> cached;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto slot = cache.find(relative_path);
+            if (slot != cache.end())
+            {
+                cached = slot->second.entry;
+                lru.splice(lru.begin(), lru, slot->second.lru_position);
+                if (cached->watched || now - cached->checked < std::chrono::seconds(config.revalidate_after_seconds))
+                {
+                    return cached;
+                }
+            }
+        }
+
+        // Watched before the file is looked at, so a change made while loading it is reported.
+        uint64_t generation = 0;
+        bool watched = watch_directories(relative_path, generation);
+
+        // The file system is only touched outside the lock; concurrent misses of one path load it more than once.
+        if (cached)
+        {
+            FileStatus status;
+            bool exists = File::status(root + "/" + relative_path, status);
+            if (exists == cached->exists && (!exists || status.same_file(cached->status)) && siblings_unchanged(relative_path, *cached))
+            {
+                auto refreshed = std::make_shared<Entry>(*cached);
+                refreshed->checked = now;
+                refreshed->watched = watched;
+                insert(relative_path, refreshed, generation);
+                return refreshed;
+            }
+        }
+        std::shared_ptr<Entry> entry = load(relative_path);
+        entry->watched = watched;
+        insert(relative_path, entry, generation);
+        return entry;
+    }
+
+    /// @brief Watches the directories from the root down to the one holding relative_path.
+    /// @param generation Set to the change generation the watches are current for.
+    /// @return False if changes are not watched or a directory can not be watched.
+    bool watch_directories(const std::string &relative_path, uint64_t &generation)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation = change_generation;
+        if (!watcher)
+        {
+            return false;
+        }
+        size_t end = 0;
+        while (true)
+        {
+            std::string directory = relative_path.substr(0, end);
+            if (watched_directories.count(directory) == 0)
+            {
+                int watch = watcher->watch(directory.empty() ? root : root + "/" + directory);
+                if (watch < 0)
+                {
+                    return false;
+                }
+                watches[watch] = directory;
+                watched_directories.insert(directory);
+            }
+            end = relative_path.find('/', end + 1);
+            if (end == std::string::npos)
+            {
+                return true;
+            }
+        }
+    }
+
+    /// @brief Drops the cached entries of path and of everything below it, all entries if path is empty.
+    void invalidate(const std::string &path)
+    {
+        for (auto slot = cache.begin(); slot != cache.end();)
+        {
+            const std::string &key = slot->first;
+            bool affected = path.empty() || (key.compare(0, path.size(), path) == 0 && (key.size() == path.size() || key[path.size()] == '/'));
+            if (!affected)
+            {
+                ++slot;
+                continue;
+            }
+            memory_used -= slot->second.entry->memory_size();
+            lru.erase(slot->second.lru_position);
+            slot = cache.erase(slot);
+        }
+    }
+
+    /// @brief Drops the entries of every path the watcher reported as changed.
+    void apply_changes()
+    {
+        changes.clear();
+        watcher->read_changes(changes);
+        if (changes.empty())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ++change_generation;
+        for (const FileWatcher::Change &change : changes)
+        {
+            if (change.overflow)
+            {
+                invalidate(std::string());
+                continue;
+            }
+            auto watch = watches.find(change.watch);
+            if (watch == watches.end())
+            {
+                continue;
+            }
+            const std::string &directory = watch->second;
+            std::string path = change.name.empty() ? directory : directory.empty() ? change.name : directory + "/" + change.name;
+            invalidate(path);
+            // A precompressed sibling belongs to the entry of the file it is a copy of.
+            for (const auto &precompressed : config.precompressed_files)
+            {
+                const std::string &suffix = precompressed.second;
+                if (path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0)
+                {
+                    invalidate(path.substr(0, path.size() - suffix.size()));
+                }
+            }
+            if (change.watch_removed)
+            {
+                watched_directories.erase(directory);
+                watches.erase(watch);
+            }
+        }
+    }
+
+    void insert(const std::string &relative_path, const std::shared_ptr<const Entry> &entry, uint64_t generation)
+    {
+        if (config.max_open_files == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entry->watched && generation != change_generation)
+        {
+            return;
+        }
+        auto slot = cache.find(relative_path);
+        if (slot != cache.end())
+        {
+            memory_used -= slot->second.entry->memory_size();
+            slot->second.entry = entry;
+            lru.splice(lru.begin(), lru, slot->second.lru_position);
+        }
+        else
+        {
+            lru.push_front(relative_path);
+            cache[relative_path] = CacheSlot{entry, lru.begin()};
+        }
+        memory_used += entry->memory_size();
+
+        while (!lru.empty() && (cache.size() > config.max_open_files || memory_used > config.memory_cache_size))
+        {
+            auto evicted = cache.find(lru.back());
+            memory_used -= evicted->second.entry->memory_size();
+            cache.erase(evicted);
+            lru.pop_back();
+        }
+    }
+};
+
+http::StaticFiles::StaticFiles(const std::string &root, StaticFilesConfig config) : pimpl(std::make_shared<Impl>(root, std::move(config)))
+{
+    FileStatus status;
+    if (!File::status(pimpl->root, status) || !status.is_directory)
+    {
+        throw std::invalid_argument("HTTP: Static file root is not a directory: " + root);
+    }
+}
+
+bool http::StaticFiles::serve(const HttpRequest &request, HttpResponse &response) const
+{
+    if (request.method() != http::methods::GET)
+    {
+        return false;
+    }
+    const std::string &uri = request.uri();
+    size_t path_end = uri.find_first_of("?#");
+    std::string path = uri.substr(0, path_end);
+    std::string relative_path;
+    if (!sanitize_path(path, relative_path))
+    {
+        return false;
+    }
+    bool wants_directory = path.back() == '/';
+    if (wants_directory)
+    {
+        if (pimpl->config.index_file.empty())
+        {
+            return false;
+        }
+        relative_path += relative_path.empty() ? pimpl->config.index_file : "/" + pimpl->config.index_file;
+    }
+
+    std::shared_ptr<const Impl::Entry> entry = pimpl->find(relative_path);
+    if (!entry->exists)
+    {
+        return false;
+    }
+    if (entry->status.is_directory)
+    {
+        if (wants_directory)
+        {
+            return false;
+        }
+        response.set_status_code(http::status_codes::MOVED_PERMANENTLY);
+        response.set_reason_phrase("Moved Permanently");
+        response.set_header(http::headers::LOCATION, path + "/" + (path_end == std::string::npos ? "" : uri.substr(path_end)));
+        return true;
+    }
+    if (!entry->status.is_regular)
+    {
+        return false;
+    }
+
+    const auto &headers = request.headers();
+    const Impl::Representation *representation = &entry->identity;
+    auto accept_encoding = headers.find(http::headers::ACCEPT_ENCODING);
+    if (!entry->encoded.empty() && accept_encoding != headers.end())
+    {
+        int coding = ResponseCompression::negotiate(accept_encoding->second, entry->codings);
+        if (coding >= 0)
+        {
+            representation = &entry->encoded[coding];
+        }
+    }
+
+    auto if_none_match = headers.find(http::headers::IF_NONE_MATCH);
+    if (if_none_match != headers.end() && ResponseCache::etag_matches(if_none_match->second, representation->etag))
+    {
+        response.set_snapshot(representation->not_modified);
+        return true;
+    }
+    if (representation->response)
+    {
+        response.set_snapshot(representation->response);
+        return true;
+    }
+
+    response.set_status_code(http::status_codes::OK);
+    response.set_reason_phrase("OK");
+    response.set_header(http::headers::CONTENT_TYPE, entry->content_type);
+    response.set_header(http::headers::ACCEPT_RANGES, "bytes");
+    if (!representation->coding.empty())
+    {
+        response.set_header(http::headers::CONTENT_ENCODING, representation->coding);
+    }
+    pimpl->set_entity_headers(response, *entry, *representation);
+    response.set_header(http::headers::CONTENT_LENGTH, std::to_string(representation->size));
+    FileRegion region;
+    region.file = representation->file;
+    region.length = representation->size;
+    HttpResponseBuilder::set_body_file(response, region);
+    return true;
+}
+
+void http::StaticFiles::operator()(const HttpRequest &request, HttpResponse &response) const
+{
+    if (serve(request, response))
+    {
+        return;
+    }
+    if (request.method() != http::methods::GET)
+    {
+        response.set_status_text(http::status_codes::METHOD_NOT_ALLOWED, "Method Not Allowed");
+        response.set_header(http::headers::ALLOW, http::methods::GET);
+    }
+    else
+    {
+        response.set_status_text(http::status_codes::NOT_FOUND, "Not Found");
+    }
+}
+
+int http::StaticFilesWatch::enable(const StaticFiles &files)
+{
+    StaticFiles::Impl &impl = *files.pimpl;
+    std::unique_ptr<FileWatcher> watcher(new FileWatcher());
+    if (watcher->handle() < 0)
+    {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    if (impl.watcher)
+    {
+        throw std::logic_error("HTTP: Static files are already watched");
+    }
+    // Entries cached so far were not watched when they were loaded.
+    impl.invalidate(std::string());
+    impl.watcher = std::move(watcher);
+    return impl.watcher->handle();
+}
+
+void http::StaticFilesWatch::disable(const StaticFiles &files)
+{
+    StaticFiles::Impl &impl = *files.pimpl;
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    // Entries cached so far count on change reports that will not come, loads still in progress are not cached either.
+    ++impl.change_generation;
+    impl.invalidate(std::string());
+    impl.watches.clear();
+    impl.watched_directories.clear();
+    impl.watcher.reset();
+}
+
+void http::StaticFilesWatch::apply_changes(const StaticFiles &files)
+{
+    files.pimpl->apply_changes();
+}
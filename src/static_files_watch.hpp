@@ -0,0 +1,24 @@
+#ifndef STATIC_FILES_WATCH_HPP
+#define STATIC_FILES_WATCH_HPP
+
+#include "http/http_static_files.hpp"
+
+namespace http
+{
+    /// Connects the file cache of a StaticFiles to the server's event loop, see HttpServer::watch_static_files.
+    struct StaticFilesWatch
+    {
+        /// @brief Switches the cache from revalidating entries by age to dropping them when their files change.
+        /// @return Handle to poll for readability, after which apply_changes has to be called; -1 if watching is not supported.
+        /// @throws std::logic_error If the files are already watched.
+        static int enable(const StaticFiles &files);
+
+        /// @brief Undoes enable, for a watch whose handle could not be polled; entries go back to being revalidated by age.
+        static void disable(const StaticFiles &files);
+
+        /// @brief Reads the reported changes and drops the affected cache entries. Called by the event loop thread.
+        static void apply_changes(const StaticFiles &files);
+    };
+}
+
+#endif // STATIC_FILES_WATCH_HPP
@@ -10,6 +10,8 @@
 namespace tcp
 {
     typedef int SocketHandle;
+    /// Open file to send from: a file descriptor on POSIX, a HANDLE on Windows.
+    typedef intptr_t FileHandle;
     typedef uint16_t Port;
 
     namespace constants
@@ -109,11 +111,12 @@ namespace tcp
     {
     private:
         SocketFD socket_fd;
-        std::string ip_;
+        // IPv4 address of the peer in network byte order, formatted only on demand.
+        uint32_t ip_;
         Port port_;
 
     public:
-        explicit ConnectionSocket(const SocketHandle handle, const std::string &ip, const Port port) noexcept : socket_fd(handle), ip_(ip), port_(port) {}
+        explicit ConnectionSocket(const SocketHandle handle, const uint32_t ip, const Port port) noexcept : socket_fd(handle), ip_(ip), port_(port) {}
 
         ConnectionSocket(ConnectionSocket &&) = default;
         ConnectionSocket &operator=(ConnectionSocket &&) = default;
@@ -125,21 +128,31 @@ namespace tcp
         {
             return socket_fd.fd();
         }
-        /// Sends bytes in the half-open range [start_pos, end_pos) from data.
-        size_t send_data(const std::vector<char> &data, size_t start_pos, size_t end_pos);
-        /// Receives bytes into buffer starting at buffer_cursor.
+        /// Sends up to length bytes starting at data, stopping early when the socket would block.
+        size_t send_data(const char *data, size_t length);
+        /// Sends head followed by data in one gathered write, so both parts cost a single system call.
+        /// Stops early when the socket would block.
+        /// @return Bytes sent, counting head bytes first.
+        size_t send_data(const char *head, size_t head_length, const char *data, size_t length);
+        /// Sends length bytes of a file starting at offset, without copying them through user space where the platform allows it.
+        /// Stops early when the socket would block.
+        /// @return Bytes sent.
+        /// @throws exceptions::CanNotSendData If the file ends before offset + length or the socket fails.
+        size_t send_file(FileHandle file, uint64_t offset, size_t length);
+        /// Receives up to capacity bytes into buffer.
         /// If read_once is true, performs at most one underlying socket read.
-        size_t receive_data(std::vector<char> &buffer, size_t buffer_cursor, bool read_once = false);
+        /// Stops after max_bytes even if the socket still has data, so callers can share a thread fairly.
+        size_t receive_data(char *buffer, size_t capacity, bool read_once = false, size_t max_bytes = static_cast<size_t>(-1));
 
         /// Enables blocking mode; optional timeout is in milliseconds (0 means default blocking behavior).
         void set_socket_blocking(time_t blocking_timeout_in_milliseconds = 0);
         void set_socket_non_blocking();
 
+        /// @return Size of the kernel send buffer (SO_SNDBUF) in bytes, or 0 if it can not be queried.
+        size_t send_buffer_size() const noexcept;
+
         /// @return IP address of the connected peer as a string
-        std::string get_ip() const
-        {
-            return ip_;
-        }
+        std::string get_ip() const;
 
         /// @return Port number of the connected peer
         Port get_port() const noexcept
@@ -172,9 +185,12 @@ namespace tcp
         {
             return socket_fd.fd();
         }
-        /// @brief Accepts an incoming connection and returns a ConnectionSocket object
-        /// @return Newly accepted connections available at call time.
-        std::vector<ConnectionSocket> accept_connections();
+        /// @brief Accepts pending connections into a caller owned array.
+        /// The array is cleared first; reserving its capacity once keeps the accept path free of allocations.
+        /// @param connections Array receiving newly accepted non-blocking sockets.
+        /// @param max_connections Maximum number of connections to accept in this call. Remaining peers stay in the backlog.
+        /// @return Number of connections accepted.
+        size_t accept_connections(std::vector<ConnectionSocket> &connections, size_t max_connections);
 
         /// @return IP address the socket is bound to as a string
         std::string get_ip() const
@@ -3,6 +3,8 @@
 #include "tcp.hpp"
 
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -12,6 +14,7 @@
 #include <csignal>
 #include <cstring>
 #include <cerrno>
+#include <algorithm>
 
 tcp::ListeningSocket::ListeningSocket(const uint32_t ip, const tcp::Port port, const unsigned int max_pending)
 {
@@ -90,16 +93,17 @@ tcp::ListeningSocket::ListeningSocket(const uint32_t ip, const tcp::Port port, c
     }
 }
 
-std::vector<tcp::ConnectionSocket> tcp::ListeningSocket::accept_connections()
+size_t tcp::ListeningSocket::accept_connections(std::vector<ConnectionSocket> &connections, size_t max_connections)
 {
     try
     {
-        std::vector<ConnectionSocket> connections;
-        while (true)
+        connections.clear();
+        while (connections.size() < max_connections)
         {
             sockaddr_in client_addr{};
             socklen_t client_len = sizeof(client_addr);
-            tcp::SocketHandle sock = accept(socket_fd.fd(), reinterpret_cast<struct sockaddr *>(&client_addr), &client_len);
+            // accept4 hands back the socket already non-blocking and close-on-exec, saving two fcntl calls per peer.
+            tcp::SocketHandle sock = accept4(socket_fd.fd(), reinterpret_cast<struct sockaddr *>(&client_addr), &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
             if (sock < 0)
             {
                 int err = errno;
@@ -107,32 +111,20 @@ std::vector<tcp::ConnectionSocket> tcp::ListeningSocket::accept_connections()
                 {
                     break;
                 }
+                if (err == EINTR || err == ECONNABORTED)
+                {
+                    continue;
+                }
                 throw tcp::exceptions::CanNotAcceptConnection{std::string("TCP: ") + std::string(strerror(err))};
             }
-            int flags = fcntl(sock, F_GETFL, 0);
-            if (flags == -1)
-                flags = 0;
-            flags |= O_NONBLOCK;
-            if (fcntl(sock, F_SETFL, flags) < 0)
-            {
-                int err = errno;
-                throw tcp::exceptions::CanNotSetSocketOptions{std::string("TCP: ") + std::string(strerror(err))};
-            }
-            std::string client_ip = std::string(inet_ntoa(client_addr.sin_addr));
-            tcp::Port client_port = ntohs(client_addr.sin_port);
-            ConnectionSocket client_socket(sock, client_ip, client_port);
-            connections.push_back(std::move(client_socket));
+            connections.emplace_back(sock, client_addr.sin_addr.s_addr, ntohs(client_addr.sin_port));
         }
-        return connections;
+        return connections.size();
     }
     catch (const tcp::exceptions::CanNotAcceptConnection &e)
     {
         throw;
     }
-    catch (const tcp::exceptions::CanNotSetSocketOptions &e)
-    {
-        throw tcp::exceptions::CanNotAcceptConnection{"TCP: Failed to set socket options: " + std::string(e.what())};
-    }
     catch (const std::exception &e)
     {
         throw tcp::exceptions::CanNotAcceptConnection{"TCP: Failed to accept connection: " + std::string(e.what())};
@@ -143,22 +135,27 @@ std::vector<tcp::ConnectionSocket> tcp::ListeningSocket::accept_connections()
     }
 }
 
-size_t tcp::ConnectionSocket::send_data(const std::vector<char> &data, size_t start_pos, size_t end_pos)
+std::string tcp::ConnectionSocket::get_ip() const
+{
+    in_addr addr{};
+    addr.s_addr = ip_;
+    char ip_str[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+    return std::string(ip_str);
+}
+
+size_t tcp::ConnectionSocket::send_data(const char *data, size_t length)
 {
     try
     {
-        if (end_pos > data.size())
-        {
-            throw tcp::exceptions::CanNotSendData{"TCP: Send range exceeds buffer size."};
-        }
-        if (start_pos >= end_pos)
+        if (length == 0)
         {
             return 0;
         }
 
         ssize_t total_sent = 0;
-        ssize_t data_length = static_cast<ssize_t>(end_pos - start_pos);
-        const char *data_ptr = data.data() + start_pos;
+        ssize_t data_length = static_cast<ssize_t>(length);
+        const char *data_ptr = data;
 
         while (total_sent < data_length)
         {
@@ -186,20 +183,67 @@ size_t tcp::ConnectionSocket::send_data(const std::vector<char> &data, size_t st
     }
 }
 
-size_t tcp::ConnectionSocket::receive_data(std::vector<char> &buffer, size_t buffer_cursor, bool read_once)
+size_t tcp::ConnectionSocket::send_data(const char *head, size_t head_length, const char *data, size_t length)
 {
     try
     {
-        size_t total_received = 0;
-        while (true)
+        size_t total_length = head_length + length;
+        size_t total_sent = 0;
+        while (total_sent < total_length)
         {
-            int remaining_space = (buffer.size() - buffer_cursor) - total_received;
-            if (remaining_space <= 0)
+            iovec parts[2];
+            int part_count = 0;
+            if (total_sent < head_length)
             {
-                break;
+                parts[part_count].iov_base = const_cast<char *>(head + total_sent);
+                parts[part_count].iov_len = head_length - total_sent;
+                ++part_count;
+            }
+            size_t data_sent = total_sent > head_length ? total_sent - head_length : 0;
+            if (data_sent < length)
+            {
+                parts[part_count].iov_base = const_cast<char *>(data + data_sent);
+                parts[part_count].iov_len = length - data_sent;
+                ++part_count;
             }
 
-            long bytes_received = recv(socket_fd.fd(), buffer.data() + buffer_cursor + total_received, remaining_space, 0);
+            msghdr message = {};
+            message.msg_iov = parts;
+            message.msg_iovlen = part_count;
+            ssize_t bytes_sent = sendmsg(socket_fd.fd(), &message, 0);
+            if (bytes_sent < 0)
+            {
+                int err = errno;
+                if (err == EAGAIN || err == EWOULDBLOCK)
+                {
+                    break;
+                }
+                throw tcp::exceptions::CanNotSendData{std::string(strerror(err))};
+            }
+            total_sent += static_cast<size_t>(bytes_sent);
+        }
+        return total_sent;
+    }
+    catch (const std::exception &e)
+    {
+        throw tcp::exceptions::CanNotSendData{"TCP: Failed to send all data: " + std::string(e.what())};
+    }
+    catch (...)
+    {
+        throw tcp::exceptions::CanNotSendData{"TCP: Unknown error while sending data."};
+    }
+}
+
+size_t tcp::ConnectionSocket::receive_data(char *buffer, size_t capacity, bool read_once, size_t max_bytes)
+{
+    try
+    {
+        size_t total_received = 0;
+        while (total_received < max_bytes && total_received < capacity)
+        {
+            size_t remaining_space = std::min(capacity - total_received, max_bytes - total_received);
+
+            ssize_t bytes_received = recv(socket_fd.fd(), buffer + total_received, remaining_space, 0);
 
             if (bytes_received == 0)
             {
@@ -273,6 +317,46 @@ void tcp::ConnectionSocket::set_socket_non_blocking()
     }
 }
 
+size_t tcp::ConnectionSocket::send_file(FileHandle file, uint64_t offset, size_t length)
+{
+    size_t total_sent = 0;
+    while (total_sent < length)
+    {
+        off_t file_offset = static_cast<off_t>(offset + total_sent);
+        ssize_t bytes_sent = sendfile(socket_fd.fd(), static_cast<int>(file), &file_offset, length - total_sent);
+        if (bytes_sent < 0)
+        {
+            int err = errno;
+            if (err == EAGAIN || err == EWOULDBLOCK)
+            {
+                break;
+            }
+            if (err == EINTR)
+            {
+                continue;
+            }
+            throw tcp::exceptions::CanNotSendData{std::string(strerror(err))};
+        }
+        if (bytes_sent == 0)
+        {
+            throw tcp::exceptions::CanNotSendData{"TCP: File ended before the announced length."};
+        }
+        total_sent += static_cast<size_t>(bytes_sent);
+    }
+    return total_sent;
+}
+
+size_t tcp::ConnectionSocket::send_buffer_size() const noexcept
+{
+    int size = 0;
+    socklen_t length = sizeof(size);
+    if (getsockopt(socket_fd.fd(), SOL_SOCKET, SO_SNDBUF, &size, &length) < 0 || size < 0)
+    {
+        return 0;
+    }
+    return static_cast<size_t>(size);
+}
+
 void tcp::SocketFD::close_fd()
 {
     if (fd_ != constants::INVALID_HANDLE)
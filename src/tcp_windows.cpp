@@ -124,12 +124,12 @@ namespace tcp
         }
     }
 
-    std::vector<ConnectionSocket> ListeningSocket::accept_connections()
+    size_t ListeningSocket::accept_connections(std::vector<ConnectionSocket> &connections, size_t max_connections)
     {
         try
         {
-            std::vector<ConnectionSocket> connections;
-            while (true)
+            connections.clear();
+            while (connections.size() < max_connections)
             {
                 sockaddr_in client_addr{};
                 int client_len = sizeof(client_addr);
@@ -152,13 +152,9 @@ namespace tcp
                     throw exceptions::CanNotSetSocketOptions{std::string("TCP: ") + get_error_message()};
                 }
 
-                char client_ip[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-                Port client_port = ntohs(client_addr.sin_port);
-                ConnectionSocket client_socket(static_cast<SocketHandle>(sock), std::string(client_ip), client_port);
-                connections.push_back(std::move(client_socket));
+                connections.emplace_back(static_cast<SocketHandle>(sock), client_addr.sin_addr.s_addr, ntohs(client_addr.sin_port));
             }
-            return connections;
+            return connections.size();
         }
         catch (const exceptions::CanNotAcceptConnection &e)
         {
@@ -178,22 +174,27 @@ namespace tcp
         }
     }
 
-    size_t ConnectionSocket::send_data(const std::vector<char> &data, size_t start_pos, size_t end_pos)
+    std::string ConnectionSocket::get_ip() const
+    {
+        in_addr addr{};
+        addr.s_addr = ip_;
+        char ip_str[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+        return std::string(ip_str);
+    }
+
+    size_t ConnectionSocket::send_data(const char *data, size_t length)
     {
         try
         {
-            if (end_pos > data.size())
-            {
-                throw exceptions::CanNotSendData{"TCP: Send range exceeds buffer size."};
-            }
-            if (start_pos >= end_pos)
+            if (length == 0)
             {
                 return 0;
             }
 
             int total_sent = 0;
-            int data_length = static_cast<int>(end_pos - start_pos);
-            const char *data_ptr = data.data() + start_pos;
+            int data_length = static_cast<int>(std::min(length, static_cast<size_t>(INT_MAX)));
+            const char *data_ptr = data;
 
             while (total_sent < data_length)
             {
@@ -221,21 +222,64 @@ namespace tcp
         }
     }
 
-    size_t ConnectionSocket::receive_data(std::vector<char> &buffer, size_t buffer_cursor, bool read_once)
+    size_t ConnectionSocket::send_data(const char *head, size_t head_length, const char *data, size_t length)
     {
         try
         {
-            size_t total_received = 0;
-            while (true)
+            size_t total_length = head_length + length;
+            size_t total_sent = 0;
+            while (total_sent < total_length)
             {
-                if (buffer_cursor + total_received >= buffer.size())
+                WSABUF parts[2];
+                DWORD part_count = 0;
+                if (total_sent < head_length)
                 {
-                    break;
+                    parts[part_count].buf = const_cast<char *>(head + total_sent);
+                    parts[part_count].len = static_cast<ULONG>(std::min(head_length - total_sent, static_cast<size_t>(INT_MAX)));
+                    ++part_count;
+                }
+                size_t data_sent = total_sent > head_length ? total_sent - head_length : 0;
+                if (data_sent < length)
+                {
+                    parts[part_count].buf = const_cast<char *>(data + data_sent);
+                    parts[part_count].len = static_cast<ULONG>(std::min(length - data_sent, static_cast<size_t>(INT_MAX)));
+                    ++part_count;
                 }
 
-                size_t remaining_space = buffer.size() - buffer_cursor - total_received;
+                DWORD bytes_sent = 0;
+                if (WSASend(socket_fd.fd(), parts, part_count, &bytes_sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+                {
+                    int err = WSAGetLastError();
+                    if (err == WSAEWOULDBLOCK)
+                    {
+                        break;
+                    }
+                    throw exceptions::CanNotSendData{get_error_message()};
+                }
+                total_sent += bytes_sent;
+            }
+            return total_sent;
+        }
+        catch (const std::exception &e)
+        {
+            throw exceptions::CanNotSendData{"TCP: Failed to send all data: " + std::string(e.what())};
+        }
+        catch (...)
+        {
+            throw exceptions::CanNotSendData{"TCP: Unknown error while sending data."};
+        }
+    }
+
+    size_t ConnectionSocket::receive_data(char *buffer, size_t capacity, bool read_once, size_t max_bytes)
+    {
+        try
+        {
+            size_t total_received = 0;
+            while (total_received < max_bytes && total_received < capacity)
+            {
+                size_t remaining_space = std::min(capacity - total_received, max_bytes - total_received);
                 int bytes_to_read = static_cast<int>(std::min(remaining_space, static_cast<size_t>(INT_MAX)));
-                int bytes_received = recv(socket_fd.fd(), buffer.data() + buffer_cursor + total_received, bytes_to_read, 0);
+                int bytes_received = recv(socket_fd.fd(), buffer + total_received, bytes_to_read, 0);
 
                 if (bytes_received == 0)
                 {
@@ -320,6 +364,47 @@ namespace tcp
         }
     }
 
+    size_t ConnectionSocket::send_file(FileHandle file, uint64_t offset, size_t length)
+    {
+        // TransmitFile blocks on non-blocking sockets unless overlapped, so the file is read in pieces and sent.
+        // Only what the socket took counts as sent; the rest of a piece is read again by the next call.
+        const size_t PIECE_SIZE = 64 * 1024;
+        std::vector<char> piece(std::min(length, PIECE_SIZE));
+        size_t total_sent = 0;
+        while (total_sent < length)
+        {
+            uint64_t position = offset + total_sent;
+            OVERLAPPED location = {};
+            location.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+            location.OffsetHigh = static_cast<DWORD>(position >> 32);
+            DWORD bytes_read = 0;
+            DWORD to_read = static_cast<DWORD>(std::min(length - total_sent, piece.size()));
+            if (!ReadFile(reinterpret_cast<HANDLE>(file), piece.data(), to_read, &bytes_read, &location) || bytes_read == 0)
+            {
+                throw exceptions::CanNotSendData{"TCP: File ended before the announced length."};
+            }
+
+            size_t piece_sent = send_data(piece.data(), bytes_read);
+            total_sent += piece_sent;
+            if (piece_sent < bytes_read)
+            {
+                break;
+            }
+        }
+        return total_sent;
+    }
+
+    size_t tcp::ConnectionSocket::send_buffer_size() const noexcept
+    {
+        int size = 0;
+        int length = sizeof(size);
+        if (getsockopt(socket_fd.fd(), SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char *>(&size), &length) != 0 || size < 0)
+        {
+            return 0;
+        }
+        return static_cast<size_t>(size);
+    }
+
     void SocketFD::close_fd()
     {
         if (fd_ != constants::INVALID_HANDLE)